@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ia {
+
+// ---------------- CommandBuffer ----------------
+// Recorded callables, stored back to back in reusable chunks so recording a frame
+// allocates nothing once the buffer has warmed up. Commands run in recording order.
+class CommandBuffer {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    // One recorded command. Stays put until clear(), also when the buffer is moved.
+    struct Command {
+        void (*invoke)(void *) = nullptr;
+        void (*destroy)(void *) = nullptr;
+        void *payload = nullptr;
+        size_t next = 0;     // end of the payload; the next command follows, aligned
+    };
+
+    CommandBuffer() = default;
+    ~CommandBuffer();
+
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+    CommandBuffer(CommandBuffer &&other) noexcept;
+    CommandBuffer &operator=(CommandBuffer &&other) noexcept;
+
+    template <typename F>
+    Command &record(F &&fn);
+    // Runs a single command, e.g. when replaying out of recording order.
+    static void run(const Command &command);
+
+    // Runs every command. A throwing command doesn't stop the rest; the first
+    // exception is returned.
+    std::exception_ptr execute();
+    // Destroys the commands, keeping the chunks.
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+    size_t getCapacity() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    Command &push(size_t size, size_t align);
+    template <typename Visit>
+    void forEach(Visit &&visit);
+
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+    size_t count_ = 0;
+};
+
+template <typename F>
+CommandBuffer::Command &CommandBuffer::record(F &&fn) {
+    using Fn = std::decay_t<F>;
+    static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned commands are not supported");
+
+    Command &command = push(sizeof(Fn), alignof(Fn));
+    ::new (command.payload) Fn(std::forward<F>(fn));
+    command.invoke = [](void *payload) { (*static_cast<Fn *>(payload))(); };
+    command.destroy = [](void *payload) { static_cast<Fn *>(payload)->~Fn(); };
+    return command;
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "CommandBuffer.hpp"
+#include "DirtyRegion.hpp"
+
+namespace ia {
+
+struct CullStats {
+    size_t tested = 0;
+    size_t culled = 0;
+};
+
+// ---------------- CommandList ----------------
+// Recorder for one worker thread of a parallel scene traversal. While a Recording is
+// open on a thread, draws made there (DrawOn, Clear, drawRegionOn, scroll, Window::Clear
+// and Window::Draw) land in the list instead of the window, without taking any lock.
+// Calls that need the renderer right away (GetImage, SetSize, ...) and Display() throw
+// while recording. The window's own thread merges the lists with Window::submit().
+//
+// Each command is keyed by (target, layer, sequence). The result equals recording every
+// layer in ascending order on one thread, and within a layer the lists in the order
+// given to submit().
+//
+// Commands refer to the drawables and textures they were recorded from, so those must
+// outlive the submit() of the list. Destroying a Texture, Image or Font while recording
+// is allowed; its renderer resources are then freed when the list is submitted.
+class CommandList {
+public:
+    // Makes list the recorder of the calling thread for the scope's lifetime.
+    class Recording {
+    public:
+        explicit Recording(CommandList &list, int layer = 0);
+        ~Recording();
+
+        Recording(const Recording &) = delete;
+        Recording &operator=(const Recording &) = delete;
+
+    private:
+        CommandList &list_;
+        CommandList *previous_;
+        int previousLayer_;
+    };
+
+private:
+    // Buffers a Merged is done with, for their list to record into again. Shared, as the
+    // list may be gone by the time the render thread destroys the Merged.
+    struct Spares {
+        static constexpr size_t MAX_BUFFERS = 2;
+
+        std::mutex mutex;
+        std::vector<CommandBuffer> buffers;
+    };
+
+public:
+    // Owns the commands of a merged submit and runs them in merged order. Destroying it
+    // destroys the commands and hands the emptied buffers back to their lists, so lists
+    // recording every frame keep reusing the same chunks.
+    class Merged {
+    public:
+        Merged() = default;
+        ~Merged();
+
+        Merged(Merged &&) = default;
+        Merged &operator=(Merged &&) = default;
+
+        std::exception_ptr execute();
+        size_t size() const;
+
+    private:
+        friend class CommandList;
+
+        std::vector<std::pair<CommandBuffer, std::shared_ptr<Spares>>> buffers_;
+        std::vector<const CommandBuffer::Command *> order_;
+    };
+
+    CommandList() = default;
+
+    CommandList(const CommandList &) = delete;
+    CommandList &operator=(const CommandList &) = delete;
+
+    // target is what the command draws to, source what it reads from (may be null). Both
+    // are only compared, never dereferenced.
+    template <typename F>
+    void record(F &&fn, const void *target, const void *source);
+
+    void setLayer(int layer);
+    int getLayer() const;
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    // Draws culled while recording; Window::submit() adds them to the window's stats.
+    CullStats &getCullStats();
+    // Damage a draw left on a texture; added to region by merge(), on the window's thread.
+    void addDamage(DirtyRegion &region, SDL_Rect rect);
+
+    static CommandList *getActive();
+    // Takes the commands out of lists, which are left empty.
+    static Merged merge(std::span<CommandList *const> lists);
+
+private:
+    struct Entry {
+        const CommandBuffer::Command *command;
+        const void *target;
+        const void *source;
+        int layer;
+    };
+
+    CommandBuffer commands_;
+    std::shared_ptr<Spares> spares_ = std::make_shared<Spares>();
+    std::vector<Entry> entries_;
+    std::vector<std::pair<DirtyRegion *, SDL_Rect>> damage_;
+    int layer_ = 0;
+    CullStats cullStats_;
+};
+
+template <typename F>
+void CommandList::record(F &&fn, const void *target, const void *source) {
+    const CommandBuffer::Command &command = commands_.record(std::forward<F>(fn));
+    entries_.push_back(Entry{&command, target, source, layer_});
+}
+
+}
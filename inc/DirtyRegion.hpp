@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <SDL2/SDL.h>
+
+namespace ia {
+
+// ---------------- DirtyRegion ----------------
+// Small set of disjoint rectangles. Touching or overlapping rects are merged on
+// insertion; past MAX_RECTS everything collapses into the bounding box.
+class DirtyRegion {
+public:
+    static constexpr size_t MAX_RECTS = 8;
+
+    void add(SDL_Rect rect);
+    void clear();
+    bool empty() const;
+
+    std::span<const SDL_Rect> getRects() const;
+    SDL_Rect getBounds() const;
+
+private:
+    std::vector<SDL_Rect> rects_;
+};
+
+}
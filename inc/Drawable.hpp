@@ -1,14 +1,37 @@
 #pragma once
 
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <version>
+#if __has_include(<mdspan>)
+#include <mdspan>
+#endif
 
 #include "IAError.hpp"
 #include "dr4/texture.hpp"
 #include "dr4/math/rect.hpp"
 #include "Common.hpp"
 #include "SDLRAII.hpp"
+#include "TextCache.hpp"
+#include "GlyphAtlas.hpp"
+#include "FontFace.hpp"
+#include "GeometryBatch.hpp"
+#include "RenderState.hpp"
+#include "DirtyRegion.hpp"
+#include "PixelConvert.hpp"
+#include "Readback.hpp"
+#include "TexturePool.hpp"
+#include "CommandList.hpp"
 
 struct SDL_Renderer;
 struct SDL_Texture;
@@ -20,7 +43,6 @@ struct SDL_Color;
 namespace ia {
 
 class Window;          
-class RendererGuard; 
 
 // ---------------- Line ----------------
 class Line : public dr4::Line {
@@ -28,6 +50,7 @@ class Line : public dr4::Line {
     dr4::Vec2f end_;
     float thickness_;
     SDL_Color color_;
+    uint64_t generation_ = 0;
 
 public:
     Line() = default;
@@ -48,6 +71,54 @@ public:
     dr4::Vec2f GetEnd() const override;
     dr4::Color GetColor() const override;
     float GetThickness() const override;
+
+    // Bumped by every setter, so a Layer can tell the line changed since it was rendered.
+    uint64_t getGeneration() const;
+};
+
+// ---------------- Polyline ----------------
+// Not part of dr4: a connected stroke through many points, tessellated once and
+// submitted as a single geometry call. Points are relative to GetPos().
+class Polyline : public dr4::Drawable {
+    std::vector<dr4::Vec2f> points_;
+    dr4::Vec2f pos_{};
+    float thickness_ = 1;
+    SDL_Color color_ = SDL_Color{0, 0, 0, 255};
+    LineJoin join_ = LineJoin::MITER;
+    float miterLimit_ = 4;
+    bool closed_ = false;
+    uint64_t generation_ = 0;
+
+    mutable Mesh stroke_;
+    mutable bool strokeDirty_ = true;
+    mutable SDL_FRect strokeBounds_{};
+
+public:
+    Polyline() = default;
+    ~Polyline() override = default;
+
+    void DrawOn(dr4::Texture &texture) const override;
+
+    void SetPos(dr4::Vec2f pos) override;
+    dr4::Vec2f GetPos() const override;
+
+    void setPoints(std::span<const dr4::Vec2f> points);
+    void addPoint(dr4::Vec2f point);
+    std::span<const dr4::Vec2f> getPoints() const;
+
+    void setColor(dr4::Color color);
+    void setThickness(float thickness);
+    void setJoin(LineJoin join);
+    void setMiterLimit(float miterLimit);
+    void setClosed(bool closed);
+
+    dr4::Color getColor() const;
+    float getThickness() const;
+    LineJoin getJoin() const;
+    float getMiterLimit() const;
+    bool isClosed() const;
+
+    uint64_t getGeneration() const;
 };
 
 // ---------------- Circle ----------------
@@ -57,6 +128,8 @@ class Circle : public dr4::Circle {
     float borderThickness_;
     SDL_Color fillColor_;
     SDL_Color borderColor_;
+    bool antialiased_ = false;
+    uint64_t generation_ = 0;
 
 public:
     Circle() = default;
@@ -80,6 +153,12 @@ public:
     dr4::Color GetFillColor() const override;
     dr4::Color GetBorderColor() const override;
     float GetBorderThickness() const override;
+
+    // Adds a one pixel alpha fringe around the outer edge.
+    void setAntialiased(bool antialiased);
+    bool isAntialiased() const;
+
+    uint64_t getGeneration() const;
 };
 
 // ---------------- Rectangle ----------------
@@ -88,6 +167,7 @@ class Rectangle : public dr4::Rectangle {
     float borderThickness_;
     SDL_Color fillColor_;
     SDL_Color borderColor_;
+    uint64_t generation_ = 0;
 
 public:
     Rectangle() = default;
@@ -109,21 +189,50 @@ public:
     dr4::Color GetFillColor() const override;
     float GetBorderThickness() const override;
     dr4::Color GetBorderColor() const override;
+
+    uint64_t getGeneration() const;
 };
 
 // ---------------- Font ----------------
 class Font : public dr4::Font {
+public:
+    // Filled lazily from SDL_ttf; once warm, measuring a string needs no FreeType calls.
+    struct Metrics {
+        static constexpr Uint32 ASCII_TABLE_SIZE = 128;
+
+        int ascent = 0;
+        int descent = 0;
+        int height = 0;
+        int lineSkip = 0;
+        bool kerning = false;
+
+        std::array<int, ASCII_TABLE_SIZE> asciiAdvances{};
+        std::unordered_map<Uint32, int> advances;
+        std::unordered_map<uint64_t, int> kerningPairs;
+    };
+
+private:
     static constexpr int DEFAULT_FONT_SIZE = 24;
+    static constexpr size_t MAX_CACHED_SIZES = 8;
 
     int fontSize_ = DEFAULT_FONT_SIZE;
-    raii::TTF_Font font_;
+    std::shared_ptr<FontFaceRegistry> registry_;
+    std::shared_ptr<const FontFace> face_;
     std::optional<std::string> lastFileLoadpath;
-    raii::SDL_RWops lastLoadBufer;
+    // Set for fonts made by Window::CreateFont. A threaded window may still have text
+    // using this font queued; loading and destruction wait for it.
+    const Window *window_ = nullptr;
+
+    // One TTF_Font per point size, all opened over face_, most recently used first.
+    mutable std::list<std::pair<int, raii::TTF_Font>> sizedFonts_;
+    mutable std::unordered_map<int, Metrics> metrics_;
+    // Measuring on the app thread and drawing on a render thread share the caches.
+    mutable std::recursive_mutex mutex_;
 
     friend class Text;
 
 public:
-    Font();
+    explicit Font(std::shared_ptr<FontFaceRegistry> registry = nullptr, const Window *window = nullptr);
     ~Font() override;
 
     void LoadFromFile(const std::string& path) override;
@@ -135,25 +244,38 @@ public:
     float getFontSize() const;
     void setFontSize(float fontSize);
 
-private:
-    void setFontSizeDetail(float fontSize) const;
-    void resetFont();
-};
+    uint64_t getFaceId() const;
+    bool isLoaded() const;
+    ::TTF_Font *getHandle(float fontSize) const;
 
-// ---------------- FontGuard ----------------
-struct FontGuard {
-    Font *font_;
-    float savedFontSize_;
+    const Metrics &getMetrics(float fontSize) const;
+    int getAdvance(float fontSize, Uint32 codepoint) const;
+    int getKerning(float fontSize, Uint32 left, Uint32 right) const;
+    dr4::Vec2f measure(std::string_view text, float fontSize) const;
 
-    explicit FontGuard(Font *font);
-    ~FontGuard();
+private:
+    void resetFont();
+    // Frees the window's cached text of face_ if this font is its last user.
+    void dropFaceCaches() const;
+    void openFace();
+    static int toPointSize(float fontSize);
+    Metrics &getMetricsDetail(int pointSize) const;
 };
 
 // ---------------- Text ----------------
 class Text : public dr4::Text {
+public:
+    // STRING_CACHE suits static labels, GLYPH_ATLAS suits text that changes every frame.
+    enum class RenderMode {
+        STRING_CACHE,
+        GLYPH_ATLAS
+    };
+
+private:
     static constexpr float DEFAULT_FONT_SIZE = 24;
     
     float fontSize_ = DEFAULT_FONT_SIZE;
+    RenderMode renderMode_ = RenderMode::STRING_CACHE;
     Font *font_ = nullptr;
     
     SDL_Color color_ = SDL_Color{0,0,0,255};
@@ -162,6 +284,13 @@ class Text : public dr4::Text {
     dr4::Text::VAlign vAlign_ = dr4::Text::VAlign::TOP;
     dr4::Vec2f pos_{};
 
+    // Valid while the text, size and face it was measured with are unchanged.
+    mutable std::optional<dr4::Vec2f> cachedBounds_;
+    mutable uint64_t cachedBoundsFaceId_ = 0;
+    // Also bumped when the font's face changed since the last getGeneration().
+    mutable uint64_t generation_ = 0;
+    mutable uint64_t generationFaceId_ = 0;
+
 public:
     Text(const Font *font);
     ~Text() override = default;
@@ -183,17 +312,70 @@ public:
     VAlign             GetVAlign() const override;
     const Font        *GetFont() const override;
 
+    void setRenderMode(RenderMode mode);
+    RenderMode getRenderMode() const;
+
+    uint64_t getGeneration() const;
+
+private:
+    // Static so a recorded draw doesn't depend on the Text outliving it.
+    static void DrawTextDetail(const raii::SDL_Renderer &renderer, TextTextureCache &textCache,
+                               Font *font, float fontSize, const char* text,
+                               int x, int y, VAlign valign, SDL_Color color);
+    static void DrawGlyphRun(const raii::SDL_Renderer &renderer, GlyphAtlasCache &atlases,
+                             Font *font, float fontSize, std::string_view text,
+                             int x, int y, VAlign valign, SDL_Color color);
+
+    static int valignOffset(VAlign valign, int height, int ascent);
+};
+
+// ---------------- PixelView ----------------
+// 2D view over image pixels, indexed as view[y, x].
+#if defined(__cpp_lib_mdspan)
+template <typename T>
+using PixelView = std::mdspan<T, std::dextents<size_t, 2>, std::layout_stride>;
+
+template <typename T>
+PixelView<T> makePixelView(T *data, size_t height, size_t width, size_t rowStride) {
+    using Extents = std::dextents<size_t, 2>;
+    return PixelView<T>(data, std::layout_stride::mapping<Extents>(Extents(height, width),
+                                                                    std::array<size_t, 2>{rowStride, 1}));
+}
+#else
+// The subset of std::mdspan used by the plugin, for standard libraries without <mdspan>.
+template <typename T>
+class PixelView {
+public:
+    PixelView(T *data, size_t height, size_t width, size_t rowStride)
+        : data_(data), extents_{height, width}, rowStride_(rowStride) {}
+
+    T &operator[](size_t y, size_t x) const { return data_[y * rowStride_ + x]; }
+
+    T *data_handle() const { return data_; }
+    size_t extent(size_t rank) const { return extents_[rank]; }
+    size_t stride(size_t rank) const { return rank == 0 ? rowStride_ : 1; }
+    size_t size() const { return extents_[0] * extents_[1]; }
+
 private:
-    void DrawTextDetail(const raii::SDL_Renderer &renderer, 
-                        Font *font, const char* text,
-                        int x, int y, VAlign valign, SDL_Color color) const;
+    T *data_;
+    std::array<size_t, 2> extents_;
+    size_t rowStride_;
 };
 
+template <typename T>
+PixelView<T> makePixelView(T *data, size_t height, size_t width, size_t rowStride) {
+    return PixelView<T>(data, height, width, rowStride);
+}
+#endif
+
+
 // ---------------- Image ----------------
+// Pixels are CANONICAL_PIXEL_FORMAT, which is byte for byte a dr4::Color array.
 class Image : public dr4::Image {
     static constexpr int BIT_PER_PIXEL = 32;
 
     dr4::Vec2f pos_;
+    uint64_t generation_ = 0;
     
 public:
     raii::SDL_Surface surface_;
@@ -215,26 +397,90 @@ public:
     float GetWidth() const override;
     float GetHeight() const override;
 
+    // Must be called after writing to surface_ directly, so the next DrawOn re-uploads the area.
+    void markDirty(SDL_Rect rect);
+    void markDirty();
+    // Bumped by SetPos and every pixel change that marks the image dirty.
+    uint64_t getGeneration() const;
+    // Replaces the pixels with area of the window's current render target, resizing if needed.
+    bool readTarget(const Window &window, SDL_Rect area);
+
+    // Bulk access. Rects are clipped to the image. The edit* calls mark what they
+    // return as dirty up front, so the spans must not be kept across a DrawOn.
+    PixelView<const dr4::Color> getPixels() const;
+    PixelView<dr4::Color> editPixels();
+    std::span<const dr4::Color> getRow(size_t y) const;
+    std::span<dr4::Color> editRow(size_t y);
+
+    void fillRect(SDL_Rect rect, dr4::Color color);
+    // pixels holds rect.w * rect.h colors, row by row.
+    void writePixels(SDL_Rect rect, std::span<const dr4::Color> pixels);
+
 private:
-    raii::SDL_Surface createSDLSurface(int width, int height);
+    // What the next upload to streamTexture_ has to do, decided when DrawOn is called.
+    struct StreamUpdate {
+        bool recreate = false;
+        bool ownerExpired = false;   // the old texture died with its renderer
+        SDL_Point size{};
+        std::vector<SDL_Rect> rects;
+    };
+
+    static raii::SDL_Surface createSDLSurface(int width, int height);
+    dr4::Color *rowData(size_t y) const;
+    size_t rowStride() const;
+    // Checks that the stream texture belongs to the window's renderer and matches the
+    // surface, and takes the dirty rects.
+    StreamUpdate takeStreamUpdate(const Window &window) const;
+    // Renderer side of the above; pixels is surface_ or a copy of it.
+    void applyStreamUpdate(const Window &window, const StreamUpdate &update, const SDL_Surface *pixels) const;
+    void releaseStreamTexture() const;
+
+    // Streaming copy of surface_ on the renderer of the last window drawn to. The token
+    // expires with that renderer, which already destroyed the texture. For a threaded
+    // window only its render thread touches streamTexture_; the rest is app side.
+    mutable raii::SDL_Texture streamTexture_;
+    mutable std::weak_ptr<const void> streamOwner_;
+    mutable const Window *streamWindow_ = nullptr;
+    mutable SDL_Point streamSize_{};
+    mutable DirtyRegion dirty_;
 };
 
 
 // ---------------- Texture ----------------
 class Texture : public dr4::Texture {
     const Window&              window_;
-    ia::raii::SDL_Texture      texture_;
+    // Taken from the window's TexturePool on first use as a target or source; see
+    // getTexture(). It may be larger than the logical width_ x height_.
+    mutable ia::raii::SDL_Texture texture_;
+    mutable int                allocWidth_ = 0;
+    mutable int                allocHeight_ = 0;
+    // Same size as texture_; scroll() renders into it and swaps, self-blits bounce through it.
+    mutable TexturePool::Allocation scratch_;
+    int                        width_;
+    int                        height_;
+    Uint32                     format_;
+    int                        access_;
     dr4::Vec2f                 pos_;
     dr4::Vec2f                 zero_;
     std::optional<SDL_Rect>    clipRect_;
-    std::unique_ptr<Image>     textureImage_;
+    // Clip in target pixels (clip or bounds, shifted by zero_); kept current by the setters.
+    SDL_Rect                   targetClipRect_{};
+    // targetClipRect_ limited to the texture: what a draw can actually touch.
+    SDL_FRect                  visibleRect_{};
+    // CPU copy handed out by GetImage, created on its first call.
+    mutable std::unique_ptr<Image> textureImage_;
+    bool                       batching_ = false;
+    mutable std::unique_ptr<ReadbackRing> readback_;
+    mutable DirtyRegion        damage_;
 
     friend class Line;
+    friend class Polyline;
     friend class Circle;
     friend class Rectangle;
     friend class Text;
     friend class Image;
     friend class Window;
+    friend class GeometryBatch;
 
 public:
     Texture(const Window &window, int width = 100, int height = 100);
@@ -261,6 +507,68 @@ public:
 
     const Window &getWindow() const;
     const ia::raii::SDL_Renderer &getRenderer() const;
+
+    // While enabled, Line/Circle/Rectangle draws onto this texture are merged into
+    // one SDL_RenderGeometry call that is submitted on the next non-batched operation.
+    void setBatching(bool batching);
+    bool isBatching() const;
+
+    // Non-blocking counterpart of GetImage: request now, collect a frame or two later.
+    // rect defaults to the whole texture and is clipped to it; returns 0 if nothing is left.
+    ReadbackTicket requestReadback(std::optional<SDL_Rect> rect = std::nullopt) const;
+    const Image *collectReadback(ReadbackTicket ticket) const;
+
+    // SetSize keeps the content and, like std::vector, only reallocates when the new size
+    // exceeds the capacity, growing by at least 1.5x. Shrinking keeps the capacity.
+    void shrinkToFit();
+    // Allocated size; zero until the texture is first used.
+    dr4::Vec2f getCapacity() const;
+    Uint32 getFormat() const;
+    int getAccess() const;
+
+    // Copies source (in this texture's pixels) into destination (relative to the target's
+    // zero), scaling if the sizes differ. The target may be this texture.
+    void drawRegionOn(dr4::Texture &texture, SDL_Rect source, SDL_Rect destination) const;
+    // Moves the content of area (default: the whole texture) by (dx, dy). The uncovered
+    // strips become transparent and are left for the caller to redraw.
+    void scroll(int dx, int dy, std::optional<SDL_Rect> area = std::nullopt);
+
+    // Union of what draws, clears and scrolls touched (in texture pixels, clipped to what was
+    // visible) since the last clearDamage(). Window::Draw() consumes it.
+    const DirtyRegion &getDamage() const;
+    void clearDamage() const;
+
+    // Frees the GetImage surface; a previously returned Image* dangles afterwards.
+    void releaseCPUMirror();
+    bool isAllocated() const;
+    bool hasCPUMirror() const;
+
+private:
+    const SDL_Rect &getTargetClipRect() const;
+    void updateTargetClipRect();
+    // True when a draw covering bounds (target pixels) can't touch a visible pixel;
+    // counted in the window's CullStats either way.
+    bool culls(const SDL_FRect &bounds) const;
+    void addDamage(const SDL_FRect &bounds) const;
+    void flushGeometry() const;
+    // Primitives build their triangles into beginGeometry() and hand them over with
+    // commitGeometry(): straight into the window's batch, or recorded for the render thread.
+    Mesh &beginGeometry() const;
+    void commitGeometry() const;
+    ::SDL_Texture *getTexture() const;
+    TexturePool::Allocation allocate(int width, int height) const;
+    void adopt(TexturePool::Allocation allocation) const;
+    // Moves the content into new storage of at least the given size.
+    void reallocate(int capacityWidth, int capacityHeight);
+    // Straight copy, no blending.
+    void copyRaw(::SDL_Texture *source, const SDL_Rect &from, ::SDL_Texture *target, const SDL_Rect &to) const;
+    void clearRect(::SDL_Texture *target, SDL_Rect rect) const;
+    ::SDL_Texture *getScratch() const;
+    void releaseTexture();
+    SDL_Rect getBounds() const;
+    // Flushes pending geometry and makes this texture the current target. The clip is the
+    // target clip rect taken when the draw was recorded, which may since have changed.
+    RenderState &bindAsTarget(const SDL_Rect &clip) const;
 };
 
 
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ia {
+
+// ---------------- FontFace ----------------
+// Immutable TTF bytes shared by every Font opened from the same file or buffer.
+// Files are memory-mapped read-only; buffers are copied once.
+class FontFace {
+public:
+    ~FontFace();
+
+    FontFace(const FontFace &) = delete;
+    FontFace &operator=(const FontFace &) = delete;
+
+    static std::shared_ptr<const FontFace> mapFile(const std::string &path);
+    static std::shared_ptr<const FontFace> copyBuffer(const void *buffer, size_t size);
+
+    const unsigned char *data() const;
+    size_t size() const;
+    uint64_t getId() const;
+
+    bool equals(const void *buffer, size_t size) const;
+
+private:
+    FontFace();
+
+    const unsigned char *data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<unsigned char> owned_;
+    uint64_t id_;
+};
+
+// ---------------- FontFaceRegistry ----------------
+// Holds weak references only: a face is unmapped as soon as its last Font lets go.
+class FontFaceRegistry {
+public:
+    std::shared_ptr<const FontFace> acquireFile(const std::string &path);
+    std::shared_ptr<const FontFace> acquireBuffer(const void *buffer, size_t size);
+
+    size_t getLiveFaceCount() const;
+
+    static uint64_t hashBuffer(const void *buffer, size_t size);
+
+private:
+    void pruneExpired();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::weak_ptr<const FontFace>> files_;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const FontFace>> buffers_;
+};
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <SDL2/SDL.h>
+
+#include "Mesh.hpp"
+#include "RenderState.hpp"
+
+namespace ia {
+
+class Texture;
+
+// ---------------- GeometryBatch ----------------
+// Collects tessellated primitives for one (target, clip) pair and submits them
+// with a single SDL_RenderGeometry call. Anything else that touches the renderer
+// must flush() first so draw order is preserved.
+class GeometryBatch {
+public:
+    struct Stats {
+        size_t primitives = 0;
+        size_t flushes = 0;
+    };
+
+    explicit GeometryBatch(RenderState &renderState);
+
+    Mesh &begin(const Texture &target, const SDL_Rect &clip);
+    void commit();
+
+    void flush();
+    // Drops pending geometry for target, which is only compared and may be gone already.
+    void discard(const Texture *target);
+
+    const Stats &getStats() const;
+
+private:
+    RenderState &renderState_;
+    const Texture *target_ = nullptr;
+    SDL_Rect clip_{};
+    Mesh mesh_;
+    Stats stats_;
+};
+
+}
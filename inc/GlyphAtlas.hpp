@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "SDLRAII.hpp"
+
+namespace ia {
+
+// ---------------- GlyphAtlas ----------------
+// Glyphs of one (face, size) pair rasterized white into shared texture pages;
+// the text color is applied through vertex colors at draw time.
+class GlyphAtlas {
+public:
+    static constexpr int PAGE_SIZE = 512;
+    static constexpr int GLYPH_PADDING = 1;
+
+    struct Glyph {
+        int page;
+        SDL_Rect rect;
+        int offsetX;
+        int advance;
+    };
+
+    GlyphAtlas() = default;
+
+    const Glyph &getGlyph(const raii::SDL_Renderer &renderer, ::TTF_Font *font, Uint32 codepoint);
+    ::SDL_Texture *getPage(int page) const;
+    size_t getPageCount() const;
+
+private:
+    Glyph rasterize(const raii::SDL_Renderer &renderer, ::TTF_Font *font, Uint32 codepoint);
+    SDL_Rect allocate(const raii::SDL_Renderer &renderer, int width, int height);
+    void addPage(const raii::SDL_Renderer &renderer);
+
+    std::vector<raii::SDL_Texture> pages_;
+    std::unordered_map<Uint32, Glyph> glyphs_;
+
+    int cursorX_ = 0;
+    int cursorY_ = 0;
+    int shelfHeight_ = 0;
+};
+
+// ---------------- GlyphAtlasCache ----------------
+class GlyphAtlasCache {
+public:
+    static constexpr size_t MAX_ATLASES = 32;
+
+    GlyphAtlas &get(uint64_t faceId, int fontSize);
+    void invalidateFace(uint64_t faceId);
+    void clear();
+
+private:
+    using Key = std::pair<uint64_t, int>;
+    using Node = std::pair<Key, std::unique_ptr<GlyphAtlas>>;
+
+    std::list<Node> lru_;
+};
+
+}
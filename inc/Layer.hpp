@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dr4/texture.hpp"
+#include "Drawable.hpp"
+
+namespace ia {
+
+// ---------------- Layer ----------------
+// Texture cache for a static part of the scene. The layer remembers the drawables that
+// were rendered into it and the generation (see Line::getGeneration) each had then.
+// DrawOn re-renders only if one of them changed since; otherwise it just blits the
+// texture. Sources are drawn in the order they were added, at their own positions in
+// the layer's pixels, and must outlive the layer or be removed first.
+class Layer : public dr4::Drawable {
+public:
+    struct Stats {
+        size_t hits = 0;        // DrawOn calls served from the texture
+        size_t misses = 0;      // DrawOn calls that found it stale
+        size_t renders = 0;     // also counts update()
+    };
+
+    explicit Layer(const Window &window, int width = 100, int height = 100);
+    ~Layer() override = default;
+
+    Layer(const Layer &) = delete;
+    Layer &operator=(const Layer &) = delete;
+
+    void DrawOn(dr4::Texture &texture) const override;
+    void SetPos(dr4::Vec2f pos) override;
+    dr4::Vec2f GetPos() const override;
+
+    void add(const Line &line);
+    void add(const Polyline &polyline);
+    void add(const Circle &circle);
+    void add(const Rectangle &rectangle);
+    void add(const Text &text);
+    void add(const Image &image);
+    void remove(const dr4::Drawable &drawable);
+    void clear();
+    size_t size() const;
+
+    void setSize(dr4::Vec2f size);
+    dr4::Vec2f getSize() const;
+    // What the texture is cleared to before re-rendering; transparent by default.
+    void setClearColor(dr4::Color color);
+
+    // For changes the generations don't see, e.g. an Image's surface_ written without markDirty.
+    void invalidate();
+    bool isStale() const;
+    // Re-renders now if stale, e.g. to keep the work out of a later DrawOn.
+    void update() const;
+
+    const Texture &getTexture() const;
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct Source {
+        const dr4::Drawable *drawable;
+        uint64_t (*generation)(const dr4::Drawable &drawable);
+        uint64_t rendered;
+    };
+
+    template <typename T>
+    void addSource(const T &drawable);
+    void render() const;
+
+    mutable Texture texture_;
+    mutable std::vector<Source> sources_;
+    dr4::Color clearColor_{0, 0, 0, 0};
+    mutable bool invalidated_ = true;
+    mutable Stats stats_;
+};
+
+template <typename T>
+void Layer::addSource(const T &drawable) {
+    auto generation = [](const dr4::Drawable &source) { return static_cast<const T &>(source).getGeneration(); };
+    sources_.push_back(Source{&drawable, generation, drawable.getGeneration()});
+    invalidated_ = true;
+}
+
+}
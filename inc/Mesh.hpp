@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+#include <SDL2/SDL.h>
+
+namespace ia {
+
+enum class LineJoin {
+    MITER,
+    ROUND,
+    BEVEL
+};
+
+// ---------------- Mesh ----------------
+// Untextured triangle list in render-target pixel coordinates, ready for SDL_RenderGeometry.
+class Mesh {
+public:
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    void clear();
+    bool empty() const;
+    // Box around all vertices; empty mesh gives a zero rect.
+    SDL_FRect getBounds() const;
+
+    void appendQuad(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_FPoint d, SDL_Color color);
+    void appendRect(SDL_FRect rect, SDL_Color color);
+    void appendLine(SDL_FPoint from, SDL_FPoint to, float thickness, SDL_Color color);
+    // Whole stroke with shared vertices between segments; miters longer than
+    // miterLimit * thickness / 2 fall back to bevels.
+    void appendPolyline(std::span<const SDL_FPoint> points, float thickness, SDL_Color color,
+                        LineJoin join, bool closed, float miterLimit = 4.0f);
+    void appendMesh(const Mesh &other, SDL_FPoint offset);
+    // segments == 0 picks a bucket from the radius.
+    void appendEllipse(SDL_FPoint center, SDL_FPoint radius, SDL_Color color, int segments = 0);
+    void appendEllipseRing(SDL_FPoint center, SDL_FPoint outerRadius, SDL_FPoint innerRadius,
+                           SDL_Color color, int segments = 0);
+    // Ring fading from color at radius to transparent at radius + width, for antialiased edges.
+    void appendEllipseFringe(SDL_FPoint center, SDL_FPoint radius, float width,
+                             SDL_Color color, int segments = 0);
+
+    static constexpr std::array<int, 9> SEGMENT_BUCKETS = {16, 24, 32, 48, 64, 96, 128, 192, 256};
+
+    static int ellipseSegments(SDL_FPoint radius);
+    // Precomputed (cos, sin) ring for one of SEGMENT_BUCKETS.
+    static const std::vector<SDL_FPoint> &unitCircle(int segments);
+
+private:
+    int addVertex(SDL_FPoint position, SDL_Color color);
+    void appendRingStrip(SDL_FPoint center, SDL_FPoint outerRadius, SDL_Color outerColor,
+                         SDL_FPoint innerRadius, SDL_Color innerColor, int segments);
+};
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <SDL2/SDL.h>
+
+#include "dr4/math/color.hpp"
+
+namespace ia {
+
+// ---------------- PixelConvert ----------------
+// CPU-side pixels in the plugin are always CANONICAL_PIXEL_FORMAT: bytes R, G, B, A in
+// memory, i.e. a plain dr4::Color array. Conversions between the four 8-bit RGBA byte
+// orders run on SSE2/AVX2 kernels picked at runtime; anything else goes to SDL_ConvertPixels.
+inline constexpr Uint32 CANONICAL_PIXEL_FORMAT = SDL_PIXELFORMAT_RGBA32;
+
+enum class PixelIsa {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+PixelIsa getPixelIsa();
+// Clamped to what the CPU supports; meant for benchmarks and for exercising the fallbacks.
+void setPixelIsa(PixelIsa isa);
+
+// True when the pair is handled by the kernels rather than by SDL.
+bool hasFastConversion(Uint32 srcFormat, Uint32 dstFormat);
+// src and dst may be the same buffer.
+void convertPixels(const void *src, int srcPitch, Uint32 srcFormat,
+                   void *dst, int dstPitch, Uint32 dstFormat, int width, int height);
+
+Uint32 packColor(dr4::Color color, Uint32 format);
+void packColors(std::span<const dr4::Color> colors, Uint32 *dst, Uint32 format);
+
+void premultiplyAlpha(std::span<dr4::Color> pixels);
+void unpremultiplyAlpha(std::span<dr4::Color> pixels);
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h> 
+#include <cstdlib>
+#include <string>
 
 #include "cum/ifc/dr4.hpp"
 #include "dr4/window.hpp"
@@ -11,10 +13,46 @@
 #include "Drawable.hpp"
 
 namespace ia {
+
+struct BackendConfig {
+    // No display or GPU required: offscreen/dummy video driver and the software renderer.
+    bool headless = false;
+    // Windows replay their draws on a render thread; see WindowOptions::threaded.
+    bool threaded = false;
+
+    // IA_GRAPHICS_HEADLESS=1 (or true/yes) turns headless mode on, IA_GRAPHICS_THREADED
+    // threaded mode.
+    static BackendConfig fromEnvironment() {
+        BackendConfig config;
+        config.headless = isFlagSet("IA_GRAPHICS_HEADLESS");
+        config.threaded = isFlagSet("IA_GRAPHICS_THREADED");
+        return config;
+    }
+
+    static bool isFlagSet(const char *name) {
+        const char *value = std::getenv(name);
+        if (!value) return false;
+        std::string flag(value);
+        return flag == "1" || flag == "true" || flag == "yes";
+    }
+};
     
 struct IAGraphicsBackEnd : public cum::DR4BackendPlugin {
-    IAGraphicsBackEnd() {
-        if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+    BackendConfig config_;
+    // Shared by every window created by this backend, so a face is loaded once per process.
+    std::shared_ptr<FontFaceRegistry> faceRegistry_ = std::make_shared<FontFaceRegistry>();
+
+    explicit IAGraphicsBackEnd(BackendConfig config = BackendConfig::fromEnvironment()) : config_(config) {
+        bool initialized = false;
+        if (config_.headless) {
+            // offscreen is missing from older SDL builds, dummy is always there.
+            SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+            initialized = SDL_Init(SDL_INIT_VIDEO) == 0;
+            if (!initialized) SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        }
+
+        if (!initialized && SDL_Init(SDL_INIT_VIDEO) != 0) {
             SDL_Quit();
             throw SDLException("IAGraphicsBackEnd : SDL_Init Error. %s\n" + std::string(SDL_GetError()));
         }
@@ -37,7 +75,13 @@ struct IAGraphicsBackEnd : public cum::DR4BackendPlugin {
     std::vector<std::string_view> GetConflicts() const override { return {}; }
     void AfterLoad() override {}
 
-    dr4::Window *CreateWindow() { return new Window("Window"); }
+    dr4::Window *CreateWindow() {
+        return new Window("Window", 100, 100, WindowOptions{faceRegistry_, config_.headless, config_.threaded});
+    }
+
+    const BackendConfig &getConfig() const { return config_; }
+
+    FontFaceRegistry &getFaceRegistry() const { return *faceRegistry_; }
 };
 
 }
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <SDL2/SDL.h>
+
+#include "SDLRAII.hpp"
+
+namespace ia {
+
+class Window;
+class Image;
+
+using ReadbackTicket = uint64_t;
+
+// ---------------- ReadbackRing ----------------
+// Deferred GPU -> CPU copies. request() only issues a GPU-side copy of the source into
+// a staging texture; the blocking SDL_RenderReadPixels happens in collect(), a frame or
+// two later, when that copy has normally finished. Each request takes the next of
+// RING_SIZE slots, so a ticket stays collectable for RING_SIZE - 1 further requests.
+class ReadbackRing {
+public:
+    static constexpr size_t RING_SIZE = 3;
+
+    struct Stats {
+        size_t requests = 0;
+        size_t collected = 0;
+        size_t dropped = 0;      // overwritten before being collected
+    };
+
+    explicit ReadbackRing(const Window &window);
+    ~ReadbackRing();
+
+    ReadbackRing(const ReadbackRing &) = delete;
+    ReadbackRing &operator=(const ReadbackRing &) = delete;
+
+    // rect is in source pixels and must lie inside the source texture.
+    ReadbackTicket request(::SDL_Texture *source, SDL_Rect rect);
+    // nullptr if the ticket is unknown or its slot was reused. The image stays valid
+    // until the slot is reused.
+    const Image *collect(ReadbackTicket ticket);
+
+    const Stats &getStats() const;
+
+private:
+    struct Slot {
+        raii::SDL_Texture staging;
+        int width = 0;
+        int height = 0;
+        ReadbackTicket ticket = 0;
+        bool collected = false;
+        std::unique_ptr<Image> image;
+    };
+
+    Slot *findSlot(ReadbackTicket ticket);
+
+    const Window &window_;
+    std::array<Slot, RING_SIZE> slots_;
+    ReadbackTicket lastTicket_ = 0;
+    Stats stats_;
+};
+
+}
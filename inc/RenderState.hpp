@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <SDL2/SDL.h>
+
+#include "SDLRAII.hpp"
+
+namespace ia {
+
+// ---------------- RenderState ----------------
+// Shadow copy of the renderer state the plugin relies on. Setters only reach SDL
+// when the value actually changes; everything in the plugin must go through here
+// instead of calling the SDL setters directly, or the shadow goes stale.
+class RenderState {
+public:
+    struct Counter {
+        size_t applied = 0;
+        size_t skipped = 0;
+    };
+
+    struct Stats {
+        Counter target;
+        Counter drawColor;
+        Counter blendMode;
+        Counter clipRect;
+    };
+
+    explicit RenderState(const raii::SDL_Renderer &renderer);
+
+    void setTarget(::SDL_Texture *target);
+    void setDrawColor(SDL_Color color);
+    void setBlendMode(SDL_BlendMode mode);
+    void setClipRect(const SDL_Rect *clip);
+
+    // Must be called before a texture that may be the current target is destroyed.
+    void forgetTarget(::SDL_Texture *texture);
+    void invalidate();
+
+    const raii::SDL_Renderer &getRenderer() const;
+    const Stats &getStats() const;
+    void resetStats();
+
+private:
+    const raii::SDL_Renderer &renderer_;
+
+    std::optional<::SDL_Texture *> target_;
+    std::optional<SDL_Color> drawColor_;
+    std::optional<SDL_BlendMode> blendMode_;
+    // Outer optional: known or not; inner optional: clipping enabled or not.
+    std::optional<std::optional<SDL_Rect>> clipRect_;
+
+    Stats stats_;
+};
+
+}
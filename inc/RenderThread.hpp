@@ -0,0 +1,101 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "CommandBuffer.hpp"
+
+namespace ia {
+
+// ---------------- RenderThread ----------------
+// Owns the thread that replays recorded commands. Two buffers: the caller records
+// frame N + 1 while frame N runs, and submit() waits for frame N before handing the
+// next one over, so at most one frame is in flight.
+//
+// Errors thrown by recorded commands surface from the next submit() or finish().
+// invoke() only rethrows what its own callable threw.
+class RenderThread {
+public:
+    struct Stats {
+        size_t frames = 0;
+        size_t commands = 0;
+        size_t syncs = 0;        // invoke() and finish() calls that had to wait
+    };
+
+    RenderThread();
+    // Runs whatever was recorded, then joins. Pending errors are dropped.
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    // Called on the render thread itself, these run fn right away.
+    template <typename F>
+    void record(F &&fn);
+    template <typename F>
+    std::invoke_result_t<F &> invoke(F &&fn);
+
+    void submit();
+    void finish();
+
+    bool isRenderThread() const;
+    Stats getStats() const;
+
+private:
+    void run();
+    // Waits for the frame in flight, then hands the recording buffer over; with wait,
+    // also for that buffer to finish.
+    void handOver(bool wait);
+    void rethrowError(bool frame);
+
+    CommandBuffer buffers_[2];
+    CommandBuffer *recording_ = &buffers_[0];
+    CommandBuffer *pending_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::exception_ptr error_;
+    bool stop_ = false;
+    Stats stats_;
+
+    std::thread thread_;
+};
+
+template <typename F>
+void RenderThread::record(F &&fn) {
+    if (isRenderThread()) {
+        fn();
+        return;
+    }
+    recording_->record(std::forward<F>(fn));
+}
+
+template <typename F>
+std::invoke_result_t<F &> RenderThread::invoke(F &&fn) {
+    using Result = std::invoke_result_t<F &>;
+    if (isRenderThread()) return fn();
+
+    std::exception_ptr error;
+    if constexpr (std::is_void_v<Result>) {
+        recording_->record([&fn, &error] {
+            try { fn(); } catch (...) { error = std::current_exception(); }
+        });
+        handOver(true);
+        if (error) std::rethrow_exception(error);
+    } else {
+        std::optional<Result> result;
+        recording_->record([&fn, &error, &result] {
+            try { result.emplace(fn()); } catch (...) { error = std::current_exception(); }
+        });
+        handOver(true);
+        if (error) std::rethrow_exception(error);
+        return std::move(*result);
+    }
+}
+
+}
@@ -12,7 +12,7 @@ struct SDLWindowDeleter   { void operator()(::SDL_Window   *p) const noexcept {
 struct SDLRendererDeleter { void operator()(::SDL_Renderer *p) const noexcept { if (p) SDL_DestroyRenderer(p); } };
 struct SDLSurfaceDeleter  { void operator()(::SDL_Surface  *p) const noexcept { if (p) SDL_FreeSurface(p); } };
 struct SDLTextureDeleter  { void operator()(::SDL_Texture  *p) const noexcept { if (p) SDL_DestroyTexture(p); } };
-struct TTFFontDeleter     { void operator()(::TTF_Font     *p) const noexcept { if (p) TTF_CloseFont(p); }};
+struct TTFFontDeleter     { void operator()(::TTF_Font     *p) const noexcept; };
 struct SDL_RWopsDeleter   { void operator()(::SDL_RWops    *p) const noexcept { if (p) SDL_RWclose(p); }}; // !!!!!!! `0 on success or a negative error code on failure; call SDL_GetError() for more information.`
 
 using SDL_Window   = std::unique_ptr<::SDL_Window,  SDLWindowDeleter>;
@@ -25,10 +25,13 @@ using SDL_RWops    = std::unique_ptr<::SDL_RWops,   SDL_RWopsDeleter>;
 SDL_Window   SDL_CreateWindow(const char* title, int x, int y, int w, int h, Uint32 flags);
 SDL_Renderer SDL_CreateRenderer(const SDL_Window &w, int index, Uint32 flags);
 SDL_Texture  SDL_CreateTexture(const SDL_Renderer &renderer, Uint32 format, int access, int w, int h);
-SDL_Surface  TTF_RenderUTF8_Blended(const TTF_Font &font, const char* text, SDL_Color color);
+SDL_Surface  TTF_RenderUTF8_Blended(::TTF_Font *font, const char* text, SDL_Color color);
 SDL_Texture  SDL_CreateTextureFromSurface(const SDL_Renderer &renderer, const SDL_Surface &surface);
 SDL_Surface  SDL_CreateRGBSurfaceWithFormat(int flags, int width, int height, int depth, Uint32 format);
 
+// Fonts are opened and closed on the app, render and worker threads, but all of them
+// share SDL_ttf's one FreeType library, which needs face creation and disposal
+// serialized. These and TTFFontDeleter take a process-wide lock for that.
 TTF_Font TTF_OpenFont(const char* file, int ptsize);
 TTF_Font TTF_OpenFontRW(::SDL_RWops* src, int freesrc, int ptsize);
 
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+
+#include "SDLRAII.hpp"
+
+namespace ia {
+
+// faceId changes on every Font::LoadFromFile/LoadFromBuffer, so entries of a
+// reloaded face can never be hit again. Fonts made by a Window drop them with
+// invalidateFace() once no other Font shares the face.
+struct TextCacheKey {
+    uint64_t faceId;
+    int fontSize;
+    Uint32 color;
+    std::string text;
+
+    bool operator==(const TextCacheKey &other) const = default;
+};
+
+struct TextCacheKeyHash {
+    size_t operator()(const TextCacheKey &key) const noexcept;
+};
+
+// ---------------- TextTextureCache ----------------
+class TextTextureCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET_BYTES = 32 * 1024 * 1024;
+
+    struct Entry {
+        raii::SDL_Texture texture;
+        int width;
+        int height;
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    explicit TextTextureCache(size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+    const Entry *find(const TextCacheKey &key);
+    const Entry &insert(TextCacheKey key, raii::SDL_Texture texture);
+
+    void invalidateFace(uint64_t faceId);
+    void clear();
+
+    void setBudget(size_t budgetBytes);
+    size_t getBudget() const;
+    size_t getUsedBytes() const;
+    size_t getEntryCount() const;
+    const Stats &getStats() const;
+
+private:
+    using Node = std::pair<TextCacheKey, Entry>;
+    using LRUList = std::list<Node>;
+
+    static size_t entryBytes(const Entry &entry);
+    void evictToBudget();
+    void erase(LRUList::iterator it);
+
+    LRUList lru_;
+    std::unordered_map<TextCacheKey, LRUList::iterator, TextCacheKeyHash> index_;
+    size_t budgetBytes_;
+    size_t usedBytes_ = 0;
+    Stats stats_;
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+
+#include "SDLRAII.hpp"
+#include "RenderState.hpp"
+
+namespace ia {
+
+// ---------------- TexturePool ----------------
+// Recycles render-target textures. Requests are rounded up to size classes (quarter
+// steps between powers of two, so at most 25% slack per side); the caller keeps its
+// logical size and only draws from the top-left corner. Idle textures are destroyed
+// after maxIdleFrames calls to endFrame() or when they exceed the idle byte budget.
+class TexturePool {
+public:
+    static constexpr size_t DEFAULT_IDLE_BUDGET_BYTES = 64 * 1024 * 1024;
+    static constexpr size_t DEFAULT_MAX_IDLE_FRAMES = 120;
+    static constexpr int MIN_CLASS_SIZE = 16;
+
+    struct Allocation {
+        raii::SDL_Texture texture;
+        Uint32 format = 0;
+        int width = 0;      // allocated size, at least the requested one
+        int height = 0;
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t releases = 0;
+        size_t evictions = 0;
+    };
+
+    TexturePool(const raii::SDL_Renderer &renderer, RenderState &renderState);
+    ~TexturePool();
+
+    TexturePool(const TexturePool &) = delete;
+    TexturePool &operator=(const TexturePool &) = delete;
+
+    // Returned textures hold stale pixels from their previous owner.
+    Allocation acquire(Uint32 format, int width, int height);
+    void release(Allocation allocation);
+
+    void endFrame();
+    void trim(size_t maxIdleFrames = 0);
+
+    void setMaxIdleFrames(size_t frames);
+    void setIdleBudget(size_t bytes);
+    size_t getIdleBytes() const;
+    size_t getIdleCount() const;
+    const Stats &getStats() const;
+
+    static int sizeClass(int size);
+
+private:
+    struct Key {
+        Uint32 format;
+        int width;
+        int height;
+
+        bool operator==(const Key &other) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const noexcept;
+    };
+
+    struct Entry {
+        Key key;
+        Allocation allocation;
+        uint64_t releasedFrame;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    void evict(EntryList::iterator entry);
+    void enforceBudget();
+    static size_t bytesOf(const Allocation &allocation);
+
+    const raii::SDL_Renderer &renderer_;
+    RenderState &renderState_;
+
+    EntryList idle_;    // oldest release first
+    std::unordered_multimap<Key, EntryList::iterator, KeyHash> index_;
+
+    uint64_t frame_ = 0;
+    size_t maxIdleFrames_ = DEFAULT_MAX_IDLE_FRAMES;
+    size_t idleBudget_ = DEFAULT_IDLE_BUDGET_BYTES;
+    size_t idleBytes_ = 0;
+    Stats stats_;
+};
+
+}
@@ -1,28 +1,105 @@
 #pragma once
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <span>
 #include <string>
 #include <typeinfo>
+#include <vector>
 #include <cassert>
 #include <iostream>
 
 #include "dr4/window.hpp"
 
 #include "Drawable.hpp"
+#include "RenderThread.hpp"
+#include "CommandList.hpp"
+#include "Layer.hpp"
 
 namespace ia {
 
 static constexpr size_t BUFER_SIZE = 32;
 static char BUFER[BUFER_SIZE] = {};
 
+struct WindowOptions {
+    std::shared_ptr<FontFaceRegistry> faceRegistry = nullptr;
+    // Software renderer only; meant to run on the dummy/offscreen video driver.
+    bool headless = false;
+    // Draws are recorded and replayed by a render thread that owns the SDL_Renderer.
+    bool threaded = false;
+    // Draws are held until the frame ends and replayed grouped by target; see setDeferred().
+    bool deferred = false;
+    // The frame is kept in an offscreen backbuffer and only damage is redrawn; see setRetained().
+    bool retained = false;
+};
+
 class Window : public dr4::Window {
+public:
+    // Called from Display() with the finished frame, before it is presented.
+    using DisplayHook = std::function<void(const Image &frame)>;
+
+private:
+    // A Window::Draw call, as seen by damage tracking. texture is only compared: it may
+    // be destroyed before Display().
+    struct WindowDraw {
+        const Texture *texture;
+        SDL_Rect source;
+        SDL_Rect destination;
+        // The texture's damage when it was drawn, in window pixels.
+        std::vector<SDL_Rect> damage;
+
+        bool samePlacement(const WindowDraw &other) const {
+            return texture == other.texture && sameRect(source, other.source) &&
+                   sameRect(destination, other.destination);
+        }
+    };
+
+    // First member, so it is joined after everything below has been destroyed.
+    std::unique_ptr<RenderThread> renderThread_;
     raii::SDL_Renderer renderer_;
     raii::SDL_Window window_;
+    mutable TextTextureCache textCache_;
+    mutable GlyphAtlasCache glyphAtlases_;
+    mutable RenderState renderState_{renderer_};
+    mutable GeometryBatch geometryBatch_{renderState_};
+    mutable TexturePool texturePool_{renderer_, renderState_};
+    mutable CullStats cullStats_;
     std::string title_;
     dr4::Vec2f size_;
+    std::shared_ptr<FontFaceRegistry> faceRegistry_;
+    bool headless_;
+    Uint32 textureFormat_ = SDL_PIXELFORMAT_ARGB8888;
+
+    DisplayHook displayHook_;
+    std::unique_ptr<Image> frameImage_;
+
+    bool deferred_ = false;
+    mutable CommandList frameList_;
+    size_t frameStartSwitches_ = 0;
+    std::atomic<size_t> frameTargetSwitches_ = 0;
+
+    // Damage tracking, on the thread that owns the window.
+    bool retained_ = false;
+    SDL_Color clearColor_{0, 0, 0, 255};
+    std::optional<SDL_Color> frameClearColor_;
+    std::vector<WindowDraw> frameDraws_;
+    std::vector<WindowDraw> lastDraws_;
+    DirtyRegion frameDamage_;
+    // Set when something happened that damage tracking can't follow.
+    std::atomic<bool> fullDamage_ = true;
+    // Offscreen copy of the frame for retained mode, and what each Draw() of the frame
+    // showed, by draw index; render side.
+    TexturePool::Allocation backbuffer_;
+    std::vector<TexturePool::Allocation> retainedCopies_;
 
     std::unique_ptr<const dr4::Font> defaultFont{};
 
+    // Lives exactly as long as renderer_; textures cached outside the window watch it.
+    std::shared_ptr<const void> rendererToken_ = std::make_shared<char>();
+
     bool isOpen_ = false;
 
 public:
@@ -30,9 +107,14 @@ public:
     (
         const std::string &title,
         const int width=100,
-        const int height=100
-    ) : title_(title), size_(width, height)
+        const int height=100,
+        WindowOptions options={}
+    ) : title_(title), size_(width, height),
+        faceRegistry_(std::move(options.faceRegistry)), headless_(options.headless),
+        deferred_(options.deferred), retained_(options.retained)
     {
+        if (options.threaded) renderThread_ = std::make_unique<RenderThread>();
+
         window_ = raii::SDL_CreateWindow(
             title_.c_str(),
             SDL_WINDOWPOS_CENTERED,
@@ -42,13 +124,31 @@ public:
         );
         requireSDLCondition(window_ != nullptr);
 
-        renderer_ = raii::SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
-        requireSDLCondition(renderer_ != nullptr);
+        invoke([this] {
+            Uint32 rendererFlags = headless_ ? SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE
+                                             : SDL_RENDERER_ACCELERATED;
+            renderer_ = raii::SDL_CreateRenderer(window_, -1, rendererFlags);
+            requireSDLCondition(renderer_ != nullptr);
 
-        requireSDLCondition(SDL_SetRenderDrawBlendMode(renderer_.get(), SDL_BLENDMODE_BLEND) == 0);
+            renderState_.setBlendMode(SDL_BLENDMODE_BLEND);
+            textureFormat_ = pickTextureFormat();
+        });
     }
 
-    ~Window() = default;
+    ~Window() {
+        if (!renderThread_) return;
+
+        // Renderer resources go on the thread that created the renderer.
+        try { renderThread_->finish(); } catch (...) {}
+        invoke([this] {
+            frameImage_.reset();
+            releaseRetained();
+            textCache_.clear();
+            glyphAtlases_.clear();
+            texturePool_.trim();
+            renderer_.reset();
+        });
+    }
 
     void SetTitle(const std::string &title) override { title_ = title; }
     const std::string &GetTitle() const override { return title_; }
@@ -57,6 +157,7 @@ public:
     void SetSize(dr4::Vec2f size) override { 
         size_ = size; 
         SDL_SetWindowSize(window_.get(), size_.x, size_.y);
+        fullDamage_ = true;
     }
 
     void Open() override {
@@ -69,31 +170,170 @@ public:
         isOpen_ = false;
     }
 
+    // In retained mode this only sets the color damaged areas are cleared to.
     void Clear(dr4::Color color) override {
-        RendererGuard renderGuard(renderer_);
-        SDL_SetRenderDrawColor(renderer_.get(), color.r, color.g, color.b, color.a);
-        SDL_RenderClear(renderer_.get());
+        if (!isTrackable()) fullDamage_ = true;
+        else frameClearColor_ = convertToSDLColor(color);
+        if (retained_) return;
+        record([this, color = convertToSDLColor(color)] {
+            geometryBatch_.flush();
+            renderState_.setTarget(nullptr);
+            renderState_.setDrawColor(color);
+            SDL_RenderClear(renderer_.get());
+        }, this);
     };
 
     void Draw(const dr4::Texture &texture) override try{        
         const Texture &src = dynamic_cast<const Texture &>(texture);
-        RendererGuard rendererGuard(renderer_);
-        
+        SDL_Rect srcRect = src.getBounds();
         SDL_Rect dstRect = SDL_Rect(src.GetPos().x, src.GetPos().y, src.GetWidth(), src.GetHeight());
-        
-        SDL_RenderCopy(renderer_.get(), src.texture_.get(), nullptr, &dstRect);
+        const bool changed = trackWindowDraw(src, srcRect, dstRect);
+        if (retained_) {
+            if (changed) {
+                record([this, index = frameDraws_.size() - 1, &src, srcRect] {
+                    retainCopy(index, src, srcRect);
+                }, this, &src);
+            }
+            return;
+        }
+
+        record([this, &src, srcRect, dstRect] {
+            ::SDL_Texture *source = src.getTexture();
+            geometryBatch_.flush();
+            renderState_.setTarget(nullptr);
+            renderState_.setClipRect(nullptr);
+
+            SDL_RenderCopy(renderer_.get(), source, &srcRect, &dstRect);
+        }, this, &src);
     } catch (const std::bad_cast& e) { std::throw_with_nested(Dr4Exception("dynamic_cast failed in Texture::drawOn")); }
 
-    void Display() override { SDL_RenderPresent(renderer_.get()); }
+    // In threaded mode this ends the recorded frame: it waits for the previous frame to
+    // finish, hands this one to the render thread and returns. Errors thrown while a
+    // frame was replayed are rethrown from the next Display().
+    void Display() override {
+        if (CommandList::getActive()) throw Dr4Exception("Window::Display : a command list is recording on this thread");
+        flushDeferred();
+        updateFrameDamage();
+        if (retained_) {
+            std::vector<SDL_Rect> damage(frameDamage_.getRects().begin(), frameDamage_.getRects().end());
+            std::vector<SDL_Rect> destinations;
+            for (const WindowDraw &draw : frameDraws_) destinations.push_back(draw.destination);
+            queue([this, damage = std::move(damage), destinations = std::move(destinations), color = clearColor_] {
+                drawRetained(damage, destinations, color);
+            });
+        }
+        lastDraws_ = std::move(frameDraws_);
+        frameDraws_.clear();
+
+        queue([this] {
+            geometryBatch_.flush();
+            renderState_.setTarget(nullptr);
+            if (displayHook_) displayHook_(readFrame());
+            SDL_RenderPresent(renderer_.get());
+            texturePool_.endFrame();
+
+            const size_t switches = renderState_.getStats().target.applied;
+            frameTargetSwitches_ = switches - frameStartSwitches_;
+            frameStartSwitches_ = switches;
+        });
+        if (renderThread_) renderThread_->submit();
+    }
+
+    bool isHeadless() const { return headless_; }
+    // In threaded mode the hook runs on the render thread.
+    void setDisplayHook(DisplayHook hook) {
+        invoke([&] { displayHook_ = std::move(hook); });
+    }
+
+    bool isThreaded() const { return renderThread_ != nullptr; }
+    // Blocks until everything recorded so far has been replayed.
+    void finish() const {
+        flushDeferred();
+        if (renderThread_) renderThread_->finish();
+    }
+
+    // While deferred, draws are held until Display() or the next call that needs the
+    // renderer (GetImage, SetSize, ...), then replayed grouped by target texture, each
+    // target in one pass. Draws that read a texture still see everything drawn to it
+    // before them. Most useful when several panels are drawn to in an interleaved order.
+    void setDeferred(bool deferred) {
+        if (!deferred) flushDeferred();
+        deferred_ = deferred;
+    }
+    bool isDeferred() const { return deferred_; }
+
+    // While retained, the frame lives in an offscreen backbuffer that survives Display().
+    // Clear() only notes the color. Draw() keeps a copy of what the texture shows right
+    // then, unless the same draw with no new damage was made last frame, so a texture may
+    // be changed and drawn again within the frame. Display() clears and redraws just the
+    // frame damage from those copies, then copies the backbuffer to the window. Costs one
+    // extra texture per Draw() of the frame. Clear() and Draw() must then be called on
+    // the window's thread.
+    void setRetained(bool retained) {
+        if (retained == retained_) return;
+        retained_ = retained;
+        fullDamage_ = true;
+        // Earlier frames left no copies to redraw from.
+        lastDraws_.clear();
+        if (!retained) queue([this] { releaseRetained(); });
+    }
+    bool isRetained() const { return retained_; }
+
+    // Window pixels the last Display() changed: moved, added or removed Draw()s, damage of
+    // the textures drawn (see Texture::getDamage) and a changed clear color.
+    const DirtyRegion &getFrameDamage() const { return frameDamage_; }
+    // SDL_SetRenderTarget calls made during the last displayed frame.
+    size_t getFrameTargetSwitches() const { return frameTargetSwitches_; }
+
+    // Merges command lists recorded on worker threads (see CommandList) and queues the
+    // result like any other draw. Must be called on the window's thread.
+    void submit(std::span<CommandList *const> lists) {
+        if (CommandList::getActive()) throw Dr4Exception("Window::submit : a command list is recording on this thread");
+
+        for (CommandList *list : lists) {
+            cullStats_.tested += list->getCullStats().tested;
+            cullStats_.culled += list->getCullStats().culled;
+        }
+        flushDeferred();
+        queue([merged = CommandList::merge(lists)]() mutable {
+            if (std::exception_ptr error = merged.execute()) std::rethrow_exception(error);
+        });
+    }
+
+    // Renderer work: goes to the thread's CommandList while one is recording, is queued for
+    // the render thread in threaded mode and runs right away otherwise. target is what fn
+    // draws to (the window itself for the backbuffer), source what it reads from.
+    template <typename F>
+    void record(F &&fn, const void *target = nullptr, const void *source = nullptr) const {
+        if (CommandList *list = CommandList::getActive()) list->record(std::forward<F>(fn), target, source);
+        else if (deferred_) frameList_.record(std::forward<F>(fn), target, source);
+        else queue(std::forward<F>(fn));
+    }
+
+    // Like record(), but waits for fn and returns its result. Also a sync point: every
+    // command recorded before it has run by then.
+    template <typename F>
+    std::invoke_result_t<F &> invoke(F &&fn) const {
+        if (CommandList::getActive()) throw Dr4Exception("Window::invoke : can't wait for the renderer while recording a command list");
+        flushDeferred();
+        if (renderThread_) return renderThread_->invoke(std::forward<F>(fn));
+        return fn();
+    }
+
+    // True when record() doesn't run commands right away, so they must not refer to
+    // state that can change before they run.
+    bool defersCommands() const { return renderThread_ || deferred_ || CommandList::getActive(); }
 
     double GetTime() override { return static_cast<double>(SDL_GetTicks64()) / 1000; }
     void Sleep(double time) override { SDL_Delay(static_cast<Uint32> (time * 1000));}
     Texture   *CreateTexture()   override { return new Texture(*this); }
     Image     *CreateImage()     override { return new Image(); }
-    Font      *CreateFont()      override { return new Font(); }
+    Font      *CreateFont()      override { return new Font(faceRegistry_, this); }
     Line      *CreateLine()      override { return new Line(); }
     Circle    *CreateCircle()    override { return new Circle(); }
     Rectangle *CreateRectangle() override { return new Rectangle(); }
+    Polyline  *createPolyline()                { return new Polyline(); }
+    Layer     *createLayer()                   { return new Layer(*this); }
 
     Text *CreateText() override try 
     { 
@@ -187,6 +427,180 @@ public:
     }
 
     const raii::SDL_Renderer &getRenderer() const { return renderer_; }
+    const std::shared_ptr<const void> &getRendererToken() const { return rendererToken_; }
+    // Format of every texture the plugin creates; CPU pixels are converted to it on upload.
+    Uint32 getTextureFormat() const { return textureFormat_; }
+
+private:
+    // Straight to the render thread, or run right away.
+    template <typename F>
+    void queue(F &&fn) const {
+        if (renderThread_) renderThread_->record(std::forward<F>(fn));
+        else fn();
+    }
+
+    static bool sameRect(const SDL_Rect &a, const SDL_Rect &b) {
+        return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+    }
+
+    // Draws from a worker's command list can't be tracked and damage the whole window.
+    bool isTrackable() const {
+        if (!CommandList::getActive()) return true;
+        if (retained_) throw Dr4Exception("Window : retained mode draws can't be recorded on a command list");
+        return false;
+    }
+
+    // Takes the texture's damage and returns whether the draw differs from the one made
+    // at the same index last frame.
+    bool trackWindowDraw(const Texture &texture, const SDL_Rect &source, const SDL_Rect &destination) {
+        if (!isTrackable()) {
+            fullDamage_ = true;
+            return true;
+        }
+
+        WindowDraw draw{&texture, source, destination, {}};
+        for (const SDL_Rect &rect : texture.getDamage().getRects()) {
+            SDL_Rect moved = {rect.x + destination.x - source.x, rect.y + destination.y - source.y, rect.w, rect.h};
+            SDL_Rect visible{};
+            if (SDL_IntersectRect(&moved, &destination, &visible)) draw.damage.push_back(visible);
+        }
+        texture.clearDamage();
+
+        const size_t index = frameDraws_.size();
+        const bool changed = index >= lastDraws_.size() || !draw.samePlacement(lastDraws_[index]) || !draw.damage.empty();
+        frameDraws_.push_back(std::move(draw));
+        return changed;
+    }
+
+    void updateFrameDamage() {
+        frameDamage_.clear();
+
+        if (frameClearColor_) {
+            const SDL_Color color = *frameClearColor_;
+            if (color.r != clearColor_.r || color.g != clearColor_.g || color.b != clearColor_.b || color.a != clearColor_.a) {
+                fullDamage_ = true;
+            }
+            clearColor_ = color;
+            frameClearColor_.reset();
+        }
+        if (fullDamage_.exchange(false)) {
+            frameDamage_.add(SDL_Rect{0, 0, static_cast<int>(size_.x), static_cast<int>(size_.y)});
+        }
+
+        for (size_t i = 0; i < std::max(frameDraws_.size(), lastDraws_.size()); ++i) {
+            if (i < frameDraws_.size() && i < lastDraws_.size() && frameDraws_[i].samePlacement(lastDraws_[i])) {
+                for (const SDL_Rect &rect : frameDraws_[i].damage) frameDamage_.add(rect);
+                continue;
+            }
+            if (i < frameDraws_.size()) frameDamage_.add(frameDraws_[i].destination);
+            if (i < lastDraws_.size()) frameDamage_.add(lastDraws_[i].destination);
+        }
+    }
+
+    // Render side of retained mode: copies what Draw() number index showed.
+    void retainCopy(size_t index, const Texture &texture, const SDL_Rect &source) {
+        if (retainedCopies_.size() <= index) retainedCopies_.resize(index + 1);
+        TexturePool::Allocation &copy = retainedCopies_[index];
+        if (!copy.texture || copy.width < source.w || copy.height < source.h) {
+            texturePool_.release(std::move(copy));
+            copy = texturePool_.acquire(textureFormat_, source.w, source.h);
+            requireSDLCondition(SDL_SetTextureBlendMode(copy.texture.get(), SDL_BLENDMODE_BLEND) == 0);
+        }
+
+        ::SDL_Texture *from = texture.getTexture();
+        geometryBatch_.flush();
+        texture.copyRaw(from, source, copy.texture.get(), SDL_Rect{0, 0, source.w, source.h});
+    }
+
+    void releaseRetained() {
+        texturePool_.release(std::move(backbuffer_));
+        for (TexturePool::Allocation &copy : retainedCopies_) texturePool_.release(std::move(copy));
+        retainedCopies_.clear();
+    }
+
+    // Render side of retained mode: repaints the damage in the backbuffer from the copies,
+    // clipped to each rect, then copies all of it to the window.
+    void drawRetained(const std::vector<SDL_Rect> &damage, const std::vector<SDL_Rect> &destinations, SDL_Color color) {
+        while (retainedCopies_.size() > destinations.size()) {
+            texturePool_.release(std::move(retainedCopies_.back()));
+            retainedCopies_.pop_back();
+        }
+
+        int w = 0, h = 0;
+        requireSDLCondition(SDL_GetRendererOutputSize(renderer_.get(), &w, &h) == 0);
+
+        std::vector<SDL_Rect> redraw = damage;
+        if (!backbuffer_.texture || backbuffer_.width < w || backbuffer_.height < h) {
+            texturePool_.release(std::move(backbuffer_));
+            backbuffer_ = texturePool_.acquire(textureFormat_, w, h);
+            requireSDLCondition(SDL_SetTextureBlendMode(backbuffer_.texture.get(), SDL_BLENDMODE_NONE) == 0);
+            redraw.assign(1, SDL_Rect{0, 0, w, h});
+        }
+
+        geometryBatch_.flush();
+        renderState_.setTarget(backbuffer_.texture.get());
+        for (const SDL_Rect &rect : redraw) {
+            renderState_.setClipRect(&rect);
+            renderState_.setBlendMode(SDL_BLENDMODE_NONE);
+            renderState_.setDrawColor(color);
+            requireSDLCondition(SDL_RenderFillRect(renderer_.get(), &rect) == 0);
+
+            for (size_t i = 0; i < destinations.size(); ++i) {
+                SDL_Rect overlap{};
+                if (i >= retainedCopies_.size() || !retainedCopies_[i].texture) continue;
+                if (!SDL_IntersectRect(&destinations[i], &rect, &overlap)) continue;
+                const SDL_Rect source = {0, 0, destinations[i].w, destinations[i].h};
+                requireSDLCondition(SDL_RenderCopy(renderer_.get(), retainedCopies_[i].texture.get(), &source,
+                                                   &destinations[i]) == 0);
+            }
+        }
+
+        renderState_.setTarget(nullptr);
+        renderState_.setClipRect(nullptr);
+        const SDL_Rect frame = {0, 0, w, h};
+        requireSDLCondition(SDL_RenderCopy(renderer_.get(), backbuffer_.texture.get(), &frame, &frame) == 0);
+    }
+
+    void flushDeferred() const {
+        if (frameList_.empty()) return;
+
+        CommandList *list = &frameList_;
+        queue([merged = CommandList::merge(std::span(&list, 1))]() mutable {
+            if (std::exception_ptr error = merged.execute()) std::rethrow_exception(error);
+        });
+    }
+
+    const Image &readFrame() {
+        int w = 0, h = 0;
+        requireSDLCondition(SDL_GetRendererOutputSize(renderer_.get(), &w, &h) == 0);
+
+        if (!frameImage_) frameImage_ = std::make_unique<Image>(w, h);
+        requireSDLCondition(frameImage_->readTarget(*this, SDL_Rect{0, 0, w, h}));
+        return *frameImage_;
+    }
+
+    // First format the renderer lists that the pixel kernels convert to natively.
+    Uint32 pickTextureFormat() const {
+        SDL_RendererInfo info{};
+        if (SDL_GetRendererInfo(renderer_.get(), &info) == 0) {
+            for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+                if (hasFastConversion(CANONICAL_PIXEL_FORMAT, info.texture_formats[i])) {
+                    return info.texture_formats[i];
+                }
+            }
+        }
+        return SDL_PIXELFORMAT_ARGB8888;
+    }
+
+public:
+    TextTextureCache &getTextCache() const { return textCache_; }
+    GlyphAtlasCache &getGlyphAtlases() const { return glyphAtlases_; }
+    GeometryBatch &getGeometryBatch() const { return geometryBatch_; }
+    RenderState &getRenderState() const { return renderState_; }
+    TexturePool &getTexturePool() const { return texturePool_; }
+    CullStats &getCullStats() const { return cullStats_; }
+    // Null unless the window is threaded.
+    RenderThread *getRenderThread() const { return renderThread_.get(); }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "CommandBuffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ia {
+
+namespace {
+
+size_t alignUp(size_t offset, size_t align) { return (offset + align - 1) / align * align; }
+
+}
+
+// ---------------- CommandBuffer ----------------
+CommandBuffer::~CommandBuffer() { clear(); }
+
+CommandBuffer::CommandBuffer(CommandBuffer &&other) noexcept
+    : chunks_(std::move(other.chunks_)),
+      current_(std::exchange(other.current_, 0)),
+      count_(std::exchange(other.count_, 0)) {}
+
+CommandBuffer &CommandBuffer::operator=(CommandBuffer &&other) noexcept {
+    if (this != &other) {
+        clear();
+        chunks_ = std::move(other.chunks_);
+        current_ = std::exchange(other.current_, 0);
+        count_ = std::exchange(other.count_, 0);
+    }
+    return *this;
+}
+
+void CommandBuffer::run(const Command &command) {
+    // invoke stays null when the command's constructor threw.
+    if (command.invoke) command.invoke(command.payload);
+}
+
+CommandBuffer::Command &CommandBuffer::push(size_t size, size_t align) {
+    auto layout = [&](const Chunk &chunk, size_t &commandAt, size_t &payloadAt) {
+        commandAt = alignUp(chunk.used, alignof(Command));
+        payloadAt = alignUp(commandAt + sizeof(Command), align);
+        return payloadAt + size <= chunk.size;
+    };
+
+    size_t commandAt = 0, payloadAt = 0;
+    while (current_ < chunks_.size() && !layout(chunks_[current_], commandAt, payloadAt)) ++current_;
+
+    if (current_ == chunks_.size()) {
+        Chunk chunk;
+        chunk.size = std::max(CHUNK_SIZE, sizeof(Command) + size + alignof(std::max_align_t));
+        chunk.data = std::make_unique<std::byte[]>(chunk.size);
+        chunks_.push_back(std::move(chunk));
+        layout(chunks_.back(), commandAt, payloadAt);
+    }
+
+    Chunk &chunk = chunks_[current_];
+    Command *command = ::new (chunk.data.get() + commandAt) Command;
+    command->payload = chunk.data.get() + payloadAt;
+    command->next = payloadAt + size;
+    chunk.used = command->next;
+    ++count_;
+    return *command;
+}
+
+template <typename Visit>
+void CommandBuffer::forEach(Visit &&visit) {
+    for (size_t i = 0; i < chunks_.size() && i <= current_; ++i) {
+        Chunk &chunk = chunks_[i];
+        for (size_t offset = 0; offset < chunk.used;) {
+            offset = alignUp(offset, alignof(Command));
+            Command *command = std::launder(reinterpret_cast<Command *>(chunk.data.get() + offset));
+            offset = command->next;
+            visit(*command);
+        }
+    }
+}
+
+std::exception_ptr CommandBuffer::execute() {
+    std::exception_ptr error;
+    forEach([&](Command &command) {
+        try {
+            run(command);
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    });
+    return error;
+}
+
+void CommandBuffer::clear() {
+    forEach([](Command &command) {
+        if (command.destroy) command.destroy(command.payload);
+    });
+    for (Chunk &chunk : chunks_) chunk.used = 0;
+    current_ = 0;
+    count_ = 0;
+}
+
+size_t CommandBuffer::size() const { return count_; }
+bool CommandBuffer::empty() const { return count_ == 0; }
+
+size_t CommandBuffer::getCapacity() const {
+    size_t capacity = 0;
+    for (const Chunk &chunk : chunks_) capacity += chunk.size;
+    return capacity;
+}
+
+}
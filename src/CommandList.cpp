@@ -0,0 +1,136 @@
+#include "CommandList.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ia {
+
+namespace {
+
+thread_local CommandList *activeList = nullptr;
+
+}
+
+// ---------------- CommandList ----------------
+CommandList::Recording::Recording(CommandList &list, int layer)
+    : list_(list), previous_(activeList), previousLayer_(list.layer_)
+{
+    list_.layer_ = layer;
+    activeList = &list_;
+}
+
+CommandList::Recording::~Recording() {
+    list_.layer_ = previousLayer_;
+    activeList = previous_;
+}
+
+void CommandList::setLayer(int layer) { layer_ = layer; }
+int CommandList::getLayer() const { return layer_; }
+
+size_t CommandList::size() const { return entries_.size(); }
+bool CommandList::empty() const { return entries_.empty(); }
+
+void CommandList::clear() {
+    entries_.clear();
+    damage_.clear();
+    commands_.clear();
+    cullStats_ = CullStats{};
+}
+
+CullStats &CommandList::getCullStats() { return cullStats_; }
+
+void CommandList::addDamage(DirtyRegion &region, SDL_Rect rect) { damage_.emplace_back(&region, rect); }
+
+CommandList *CommandList::getActive() { return activeList; }
+
+CommandList::Merged CommandList::merge(std::span<CommandList *const> lists) {
+    struct Keyed {
+        const Entry *entry;
+        size_t list;
+        size_t sequence;
+        size_t epoch = 0;
+        size_t targetRank = 0;
+    };
+
+    std::vector<Keyed> keyed;
+    for (size_t list = 0; list < lists.size(); ++list) {
+        const std::vector<Entry> &entries = lists[list]->entries_;
+        for (size_t sequence = 0; sequence < entries.size(); ++sequence) {
+            keyed.push_back(Keyed{&entries[sequence], list, sequence});
+        }
+    }
+
+    // The order serial recording would have produced.
+    std::sort(keyed.begin(), keyed.end(), [](const Keyed &a, const Keyed &b) {
+        return std::tie(a.entry->layer, a.list, a.sequence) < std::tie(b.entry->layer, b.list, b.sequence);
+    });
+
+    // Group by target. Targets are ranked by first use, so a command reading a texture
+    // still runs before later draws to it. Reading something already drawn to starts a
+    // new epoch, and nothing moves across epochs.
+    std::unordered_map<const void *, size_t> ranks;
+    std::unordered_set<const void *> written;
+    size_t epoch = 0;
+    for (Keyed &item : keyed) {
+        const Entry &entry = *item.entry;
+        if (entry.source && entry.source != entry.target && written.contains(entry.source)) {
+            ++epoch;
+            ranks.clear();
+            written.clear();
+        }
+        item.epoch = epoch;
+        item.targetRank = ranks.try_emplace(entry.target, ranks.size()).first->second;
+        written.insert(entry.target);
+    }
+
+    std::stable_sort(keyed.begin(), keyed.end(), [](const Keyed &a, const Keyed &b) {
+        return std::tie(a.epoch, a.targetRank) < std::tie(b.epoch, b.targetRank);
+    });
+
+    Merged merged;
+    merged.order_.reserve(keyed.size());
+    for (const Keyed &item : keyed) merged.order_.push_back(item.entry->command);
+
+    for (CommandList *list : lists) {
+        merged.buffers_.emplace_back(std::move(list->commands_), list->spares_);
+        {
+            std::lock_guard lock(list->spares_->mutex);
+            std::vector<CommandBuffer> &spares = list->spares_->buffers;
+            list->commands_ = spares.empty() ? CommandBuffer() : std::move(spares.back());
+            if (!spares.empty()) spares.pop_back();
+        }
+        list->entries_.clear();
+        for (auto &[region, rect] : list->damage_) region->add(rect);
+        list->damage_.clear();
+        list->cullStats_ = CullStats{};
+    }
+    return merged;
+}
+
+// ---------------- CommandList::Merged ----------------
+CommandList::Merged::~Merged() {
+    order_.clear();
+    for (auto &[buffer, spares] : buffers_) {
+        buffer.clear();
+        std::lock_guard lock(spares->mutex);
+        if (spares->buffers.size() < Spares::MAX_BUFFERS) spares->buffers.push_back(std::move(buffer));
+    }
+}
+
+std::exception_ptr CommandList::Merged::execute() {
+    std::exception_ptr error;
+    for (const CommandBuffer::Command *command : order_) {
+        try {
+            CommandBuffer::run(*command);
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    return error;
+}
+
+size_t CommandList::Merged::size() const { return order_.size(); }
+
+}
@@ -201,4 +201,51 @@ dr4::MouseButtonType convertToDr4MouseButton(const Uint8 SDLButton) {
     }
 }
 
+std::vector<Uint32> decodeUTF8(std::string_view text) {
+    static constexpr Uint32 REPLACEMENT_CHARACTER = 0xFFFD;
+
+    std::vector<Uint32> codepoints;
+    codepoints.reserve(text.size());
+
+    size_t i = 0;
+    while (i < text.size()) {
+        Uint8 lead = static_cast<Uint8>(text[i]);
+        size_t length = 0;
+        Uint32 codepoint = 0;
+
+        if      (lead < 0x80)           { length = 1; codepoint = lead; }
+        else if ((lead & 0xE0) == 0xC0) { length = 2; codepoint = lead & 0x1F; }
+        else if ((lead & 0xF0) == 0xE0) { length = 3; codepoint = lead & 0x0F; }
+        else if ((lead & 0xF8) == 0xF0) { length = 4; codepoint = lead & 0x07; }
+        else {
+            codepoints.push_back(REPLACEMENT_CHARACTER);
+            ++i;
+            continue;
+        }
+
+        if (i + length > text.size()) {
+            codepoints.push_back(REPLACEMENT_CHARACTER);
+            break;
+        }
+
+        bool valid = true;
+        for (size_t j = 1; j < length; ++j) {
+            Uint8 continuation = static_cast<Uint8>(text[i + j]);
+            if ((continuation & 0xC0) != 0x80) { valid = false; break; }
+            codepoint = (codepoint << 6) | (continuation & 0x3F);
+        }
+
+        if (!valid) {
+            codepoints.push_back(REPLACEMENT_CHARACTER);
+            ++i;
+            continue;
+        }
+
+        codepoints.push_back(codepoint);
+        i += length;
+    }
+
+    return codepoints;
+}
+
 }
\ No newline at end of file
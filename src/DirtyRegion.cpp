@@ -0,0 +1,50 @@
+#include "DirtyRegion.hpp"
+
+namespace ia {
+
+namespace {
+
+bool touches(const SDL_Rect &a, const SDL_Rect &b) {
+    return a.x <= b.x + b.w && b.x <= a.x + a.w &&
+           a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+}
+
+// ---------------- DirtyRegion ----------------
+void DirtyRegion::add(SDL_Rect rect) {
+    if (rect.w <= 0 || rect.h <= 0) return;
+
+    // Absorbing a rect can make the union touch one that was already checked.
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (auto it = rects_.begin(); it != rects_.end(); ++it) {
+            if (!touches(*it, rect)) continue;
+            SDL_UnionRect(&*it, &rect, &rect);
+            rects_.erase(it);
+            merged = true;
+            break;
+        }
+    }
+
+    rects_.push_back(rect);
+    if (rects_.size() > MAX_RECTS) {
+        SDL_Rect bounds = getBounds();
+        rects_.assign(1, bounds);
+    }
+}
+
+void DirtyRegion::clear() { rects_.clear(); }
+bool DirtyRegion::empty() const { return rects_.empty(); }
+
+std::span<const SDL_Rect> DirtyRegion::getRects() const { return rects_; }
+
+SDL_Rect DirtyRegion::getBounds() const {
+    if (rects_.empty()) return SDL_Rect{0, 0, 0, 0};
+
+    SDL_Rect bounds = rects_.front();
+    for (const SDL_Rect &rect : rects_) SDL_UnionRect(&bounds, &rect, &bounds);
+    return bounds;
+}
+
+}
@@ -2,65 +2,73 @@
 #include "Window.hpp"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
-#include <SDL2/SDL2_gfxPrimitives.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <utility>
 
 namespace ia {
 
+namespace {
+
+// Scratch mesh for primitives recorded for a render thread; copied into the command.
+thread_local Mesh recordedGeometry;
+
+}
+
 // ---------------- Texture ----------------
 Texture::Texture(const Window &window, int width, int height):
-    window_(window), texture_(nullptr), pos_{0,0}, zero_{0,0}, clipRect_(std::nullopt)
-{   
-    
-    
-
-    if (width > 0 && height > 0) {
-     
-        texture_ = ia::raii::SDL_CreateTexture(window_.getRenderer(),
-                                               SDL_PIXELFORMAT_RGBA8888,
-                                               SDL_TEXTUREACCESS_TARGET,
-                                               width, height);
-        requireSDLCondition(texture_ != nullptr);
-    
-        requireSDLCondition(SDL_SetTextureBlendMode(texture_.get(), SDL_BLENDMODE_BLEND) == 0);
-        requireSDLCondition(SDL_SetTextureAlphaMod(texture_.get(), 255) == 0);
-
-        textureImage_.reset(new Image());
-        textureImage_->SetSize({static_cast<float>(width), static_cast<float>(height)});
-
-    } else {
-        throw_invalid_argument("width/height must be positive");
-    }
+    window_(window), texture_(nullptr), width_(width), height_(height),
+    format_(window.getTextureFormat()), access_(SDL_TEXTUREACCESS_TARGET),
+    pos_{0,0}, zero_{0,0}, clipRect_(std::nullopt)
+{
+    if (width <= 0 || height <= 0) throw_invalid_argument("width/height must be positive");
+    updateTargetClipRect();
+    // Whatever a window showed at this address before, this is new content.
+    damage_.add(getBounds());
 }
 
-Texture::~Texture() = default;
+Texture::~Texture() {
+    if (!CommandList::getActive()) {
+        window_.invoke([this] {
+            window_.getGeometryBatch().discard(this);
+            releaseTexture();
+        });
+        return;
+    }
+
+    // invoke() can't wait while recording; the storage goes back to the pool when the list
+    // is submitted. Commands using the texture must have been submitted before.
+    TexturePool::Allocation texture{std::move(texture_), format_, allocWidth_, allocHeight_};
+    window_.record([&window = window_, self = this, texture = std::move(texture), scratch = std::move(scratch_)]() mutable {
+        window.getGeometryBatch().discard(self);
+        window.getTexturePool().release(std::move(texture));
+        window.getTexturePool().release(std::move(scratch));
+    }, this);
+}
 
 void Texture::DrawOn(dr4::Texture& texture) const {
     try {
         const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
-        assert(texture_ && dstTexture.texture_);
-
-        RendererGuard renderGuard(dstTexture.getRenderer());
-        requireSDLCondition(SDL_SetRenderTarget(dstTexture.getRenderer().get(), dstTexture.texture_.get()) == 0);
-
-        int textureWidth, textureHeight;
-        requireSDLCondition(SDL_QueryTexture(texture_.get(), NULL, NULL, &textureWidth, &textureHeight) == 0);
-        
-        SDL_Rect dstClipRect = convertToSDLRect(dstTexture.GetClipRect());
-        dstClipRect.x += GetZero().x;
-        dstClipRect.y += GetZero().y;
-        requireSDLCondition(SDL_RenderSetClipRect(dstTexture.getRenderer().get(), &dstClipRect) == 0);
-    
+        if (dstTexture.culls(SDL_FRect{dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y,
+                                       static_cast<float>(width_), static_cast<float>(height_)})) {
+            return;
+        }
+
+        SDL_Rect srcRect = getBounds();
         SDL_Rect dstRect = 
         {
             static_cast<int>(dstTexture.zero_.x + pos_.x),
             static_cast<int>(dstTexture.zero_.y + pos_.y),
-            textureWidth,
-            textureHeight
+            width_,
+            height_
         };
-        requireSDLCondition(SDL_RenderCopy(dstTexture.getRenderer().get(), texture_.get(), nullptr, &dstRect) == 0);
+        window_.record([this, &dstTexture, srcRect, dstRect, clip = dstTexture.getTargetClipRect()] {
+            ::SDL_Texture *source = getTexture();
+            dstTexture.bindAsTarget(clip);
+            requireSDLCondition(SDL_RenderCopy(dstTexture.getRenderer().get(), source, &srcRect, &dstRect) == 0);
+        }, &dstTexture, this);
     } catch (const std::bad_cast&) {
         std::throw_with_nested(Dr4Exception("Bad cast in Texture::DrawOn"));
     }
@@ -70,28 +78,44 @@ void Texture::SetPos(dr4::Vec2f pos) { pos_ = pos; }
 dr4::Vec2f Texture::GetPos() const { return pos_; }
 
 void Texture::SetSize(dr4::Vec2f size) {
-    raii::SDL_Texture newTexture = raii::SDL_CreateTexture(window_.getRenderer(),
-                                                           SDL_PIXELFORMAT_RGBA8888,
-                                                           SDL_TEXTUREACCESS_TARGET,
-                                                           static_cast<int>(size.x), static_cast<int>(size.y));
-    requireSDLCondition(newTexture != nullptr);
-    requireSDLCondition(SDL_SetTextureBlendMode(newTexture.get(), SDL_BLENDMODE_BLEND) == 0);
-    requireSDLCondition(SDL_SetTextureAlphaMod(newTexture.get(), 255) == 0);
+    const int width = static_cast<int>(size.x);
+    const int height = static_cast<int>(size.y);
+    if (width <= 0 || height <= 0) throw_invalid_argument("width/height must be positive");
+
+    window_.invoke([&] {
+        flushGeometry();
+        if (texture_ && (width > allocWidth_ || height > allocHeight_)) {
+            // Geometric growth like std::vector, so a drag-resize reallocates O(log n) times.
+            const int capacityWidth = width > allocWidth_ ? std::max(width, allocWidth_ + allocWidth_ / 2) : allocWidth_;
+            const int capacityHeight = height > allocHeight_ ? std::max(height, allocHeight_ + allocHeight_ / 2) : allocHeight_;
+            reallocate(capacityWidth, capacityHeight);
+        } else if (texture_) {
+            // Pixels left there before a shrink must not reappear.
+            std::array<SDL_Rect, 2> exposed = {
+                SDL_Rect{width_, 0, width - width_, height},
+                SDL_Rect{0, height_, width, height - height_}
+            };
+            for (const SDL_Rect &rect : exposed) {
+                if (rect.w > 0 && rect.h > 0) clearRect(texture_.get(), rect);
+            }
+        }
 
-    if (texture_) texture_.reset();
-    texture_.swap(newTexture);
+        width_ = width;
+        height_ = height;
+    });
+    updateTargetClipRect();
+    damage_.add(getBounds());
 }
 
-dr4::Vec2f Texture::GetSize() const {
-    int textureWidth = 0, textureHeight = 0;
-    requireSDLCondition(SDL_QueryTexture(texture_.get(), NULL, NULL, &textureWidth, &textureHeight) == 0);
-    return dr4::Vec2f{static_cast<float>(textureWidth), static_cast<float>(textureHeight)};
-}
+dr4::Vec2f Texture::GetSize() const { return dr4::Vec2f{static_cast<float>(width_), static_cast<float>(height_)}; }
+float Texture::GetWidth() const { return static_cast<float>(width_); }
+float Texture::GetHeight() const { return static_cast<float>(height_); }
 
-float Texture::GetWidth() const { return GetSize().x; }
-float Texture::GetHeight() const { return GetSize().y; }
+void Texture::SetZero(dr4::Vec2f pos) {
+    zero_ = pos;
+    updateTargetClipRect();
+}
 
-void Texture::SetZero(dr4::Vec2f pos) { zero_ = pos; }
 dr4::Vec2f Texture::GetZero() const { return zero_; }
 
 void Texture::SetClipRect(dr4::Rect2f rect) {
@@ -102,55 +126,308 @@ void Texture::SetClipRect(dr4::Rect2f rect) {
         static_cast<int>(rect.size.x),
         static_cast<int>(rect.size.y)
     );
+    updateTargetClipRect();
 }
 
-void Texture::RemoveClipRect() { clipRect_.reset(); }
+void Texture::RemoveClipRect() {
+    clipRect_.reset();
+    updateTargetClipRect();
+}
 
 dr4::Rect2f Texture::GetClipRect() const {
-    return convertToDr4Rect(clipRect_.value_or(SDL_Rect(0, 0, GetWidth(), GetHeight())));
+    return convertToDr4Rect(clipRect_.value_or(getBounds()));
 }
 
 void Texture::Clear(dr4::Color color) {
-    RendererGuard renderGuard(window_.getRenderer()); 
-    requireSDLCondition(SDL_SetRenderTarget(window_.getRenderer().get(), texture_.get()) == 0);
-    requireSDLCondition(SDL_SetRenderDrawColor(getRenderer().get(), color.r, color.g, color.b, color.a) == 0);    
-    requireSDLCondition(SDL_RenderClear(getRenderer().get()) == 0);
+    addDamage(visibleRect_);
+    window_.record([this, clip = getTargetClipRect(), color = convertToSDLColor(color)] {
+        RenderState &state = bindAsTarget(clip);
+        state.setDrawColor(color);
+        requireSDLCondition(SDL_RenderClear(getRenderer().get()) == 0);
+    }, this);
 }
 
 dr4::Image* Texture::GetImage() const {
-    int w, h;
-    if (SDL_QueryTexture(texture_.get(), nullptr, nullptr, &w, &h) != 0) return nullptr;
-
-    raii::SDL_Surface surface = raii::SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
-    if (!surface.get()) return nullptr;
-
-    SDL_Texture* old = SDL_GetRenderTarget(getRenderer().get());
-    if (SDL_SetRenderTarget(getRenderer().get(), texture_.get()) != 0) return nullptr;
-
-    if (SDL_RenderReadPixels(
-            getRenderer().get(),
-            nullptr,
-            surface->format->format,
-            surface->pixels,
-            surface->pitch
-        ) != 0)
-    {
-        SDL_SetRenderTarget(getRenderer().get(), old);
-        return nullptr;
+    return window_.invoke([this]() -> dr4::Image * {
+        ::SDL_Texture *target = getTexture();
+        flushGeometry();
+        window_.getRenderState().setTarget(target);
+        if (!textureImage_) textureImage_ = std::make_unique<Image>(width_, height_);
+        if (!textureImage_->readTarget(window_, getBounds())) return nullptr;
+
+        assert(textureImage_->GetHeight() == height_);
+        assert(textureImage_->GetWidth() == width_);
+
+        return textureImage_.get();
+    });
+}
+
+void Texture::releaseCPUMirror() { textureImage_.reset(); }
+
+bool Texture::isAllocated() const {
+    return window_.invoke([this] { return texture_ != nullptr; });
+}
+bool Texture::hasCPUMirror() const { return textureImage_ != nullptr; }
+
+const Window &Texture::getWindow() const { return window_; }
+const ia::raii::SDL_Renderer &Texture::getRenderer() const { return window_.getRenderer(); }
+
+void Texture::setBatching(bool batching) {
+    window_.invoke([this, batching] {
+        if (!batching) flushGeometry();
+        batching_ = batching;
+    });
+}
+
+bool Texture::isBatching() const { return batching_; }
+
+ReadbackTicket Texture::requestReadback(std::optional<SDL_Rect> rect) const {
+    const SDL_Rect bounds = getBounds();
+    SDL_Rect source = bounds;
+    if (rect && !SDL_IntersectRect(&*rect, &bounds, &source)) return 0;
+
+    return window_.invoke([this, source] {
+        if (!readback_) readback_ = std::make_unique<ReadbackRing>(window_);
+        return readback_->request(getTexture(), source);
+    });
+}
+
+const Image *Texture::collectReadback(ReadbackTicket ticket) const {
+    return window_.invoke([this, ticket]() -> const Image * {
+        return readback_ ? readback_->collect(ticket) : nullptr;
+    });
+}
+
+void Texture::drawRegionOn(dr4::Texture &texture, SDL_Rect source, SDL_Rect destination) const try {
+    const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
+
+    const SDL_Rect bounds = getBounds();
+    SDL_Rect clipped{};
+    if (!SDL_IntersectRect(&source, &bounds, &clipped) || destination.w <= 0 || destination.h <= 0) return;
+
+    // Keep the source -> destination mapping when the source rect was clipped.
+    const double scaleX = static_cast<double>(destination.w) / source.w;
+    const double scaleY = static_cast<double>(destination.h) / source.h;
+    SDL_Rect dstRect = {
+        static_cast<int>(dstTexture.zero_.x + destination.x + (clipped.x - source.x) * scaleX),
+        static_cast<int>(dstTexture.zero_.y + destination.y + (clipped.y - source.y) * scaleY),
+        static_cast<int>(clipped.w * scaleX),
+        static_cast<int>(clipped.h * scaleY)
+    };
+    if (dstTexture.culls(convertToSDLFRect(dstRect))) return;
+
+    window_.record([this, &dstTexture, clipped, dstRect, clip = dstTexture.getTargetClipRect()] {
+        ::SDL_Texture *from = getTexture();
+        if (&dstTexture == this) {
+            // A texture can't be source and target at once; go through the scratch texture.
+            flushGeometry();
+            ::SDL_Texture *scratch = getScratch();
+            copyRaw(from, clipped, scratch, clipped);
+            from = scratch;
+        }
+
+        dstTexture.bindAsTarget(clip);
+        requireSDLCondition(SDL_RenderCopy(getRenderer().get(), from, &clipped, &dstRect) == 0);
+    }, &dstTexture, this);
+} catch (const std::bad_cast&) { std::throw_with_nested(Dr4Exception("Bad cast in Texture::drawRegionOn")); }
+
+void Texture::scroll(int dx, int dy, std::optional<SDL_Rect> area) {
+    const SDL_Rect bounds = getBounds();
+    SDL_Rect region = bounds;
+    if (area && !SDL_IntersectRect(&*area, &bounds, &region)) return;
+    if (dx == 0 && dy == 0) return;
+    addDamage(convertToSDLFRect(region));
+
+    window_.record([this, dx, dy, bounds, region] {
+        if (!texture_) return;
+
+        flushGeometry();
+        ::SDL_Texture *scratch = getScratch();
+
+        // Build the scrolled image in the scratch texture, then swap the two.
+        const bool whole = region.x == 0 && region.y == 0 && region.w == bounds.w && region.h == bounds.h;
+        if (!whole) copyRaw(texture_.get(), bounds, scratch, bounds);
+        clearRect(scratch, region);
+
+        SDL_Rect shifted = {region.x + dx, region.y + dy, region.w, region.h};
+        SDL_Rect moved{};
+        if (SDL_IntersectRect(&shifted, &region, &moved)) {
+            const SDL_Rect from = {moved.x - dx, moved.y - dy, moved.w, moved.h};
+            copyRaw(texture_.get(), from, scratch, moved);
+        }
+
+        std::swap(texture_, scratch_.texture);
+    }, this, this);
+}
+
+Uint32 Texture::getFormat() const { return format_; }
+int Texture::getAccess() const { return access_; }
+
+const SDL_Rect &Texture::getTargetClipRect() const { return targetClipRect_; }
+
+void Texture::updateTargetClipRect() {
+    targetClipRect_ = clipRect_.value_or(getBounds());
+    targetClipRect_.x = static_cast<int>(targetClipRect_.x + zero_.x);
+    targetClipRect_.y = static_cast<int>(targetClipRect_.y + zero_.y);
+
+    const SDL_Rect bounds = getBounds();
+    SDL_Rect visible{};
+    if (!SDL_IntersectRect(&targetClipRect_, &bounds, &visible)) visible = SDL_Rect{0, 0, 0, 0};
+    visibleRect_ = convertToSDLFRect(visible);
+}
+
+bool Texture::culls(const SDL_FRect &bounds) const {
+    CommandList *list = CommandList::getActive();
+    CullStats &stats = list ? list->getCullStats() : window_.getCullStats();
+    ++stats.tested;
+
+    const bool outside = bounds.x + bounds.w <= visibleRect_.x || bounds.x >= visibleRect_.x + visibleRect_.w ||
+                         bounds.y + bounds.h <= visibleRect_.y || bounds.y >= visibleRect_.y + visibleRect_.h;
+    if (outside) ++stats.culled;
+    else addDamage(bounds);
+    return outside;
+}
+
+void Texture::addDamage(const SDL_FRect &bounds) const {
+    const float left = std::fmax(bounds.x, visibleRect_.x);
+    const float top = std::fmax(bounds.y, visibleRect_.y);
+    const float right = std::fmin(bounds.x + bounds.w, visibleRect_.x + visibleRect_.w);
+    const float bottom = std::fmin(bounds.y + bounds.h, visibleRect_.y + visibleRect_.h);
+    if (right <= left || bottom <= top) return;
+
+    const SDL_Rect rect = {
+        static_cast<int>(std::floor(left)), static_cast<int>(std::floor(top)),
+        static_cast<int>(std::ceil(right) - std::floor(left)), static_cast<int>(std::ceil(bottom) - std::floor(top))
+    };
+    if (CommandList *list = CommandList::getActive()) list->addDamage(damage_, rect);
+    else damage_.add(rect);
+}
+
+const DirtyRegion &Texture::getDamage() const { return damage_; }
+void Texture::clearDamage() const { damage_.clear(); }
+
+void Texture::flushGeometry() const { window_.getGeometryBatch().flush(); }
+
+Mesh &Texture::beginGeometry() const {
+    if (!window_.defersCommands()) return window_.getGeometryBatch().begin(*this, targetClipRect_);
+
+    recordedGeometry.clear();
+    return recordedGeometry;
+}
+
+void Texture::commitGeometry() const {
+    if (!window_.defersCommands()) {
+        window_.getGeometryBatch().commit();
+        return;
     }
 
-    SDL_SetRenderTarget(getRenderer().get(), old);
+    window_.record([this, clip = targetClipRect_, mesh = recordedGeometry] {
+        GeometryBatch &batch = window_.getGeometryBatch();
+        batch.begin(*this, clip).appendMesh(mesh, SDL_FPoint{0, 0});
+        batch.commit();
+    }, this);
+}
 
+::SDL_Texture *Texture::getTexture() const {
+    if (!texture_) adopt(allocate(width_, height_));
+    return texture_.get();
+}
 
-    textureImage_->surface_.swap(surface);
-    assert(textureImage_->GetHeight() == h);
-    assert(textureImage_->GetWidth() == w);
+TexturePool::Allocation Texture::allocate(int width, int height) const {
+    TexturePool::Allocation allocation = window_.getTexturePool().acquire(format_, width, height);
+    requireSDLCondition(SDL_SetTextureBlendMode(allocation.texture.get(), SDL_BLENDMODE_BLEND) == 0);
+    requireSDLCondition(SDL_SetTextureAlphaMod(allocation.texture.get(), 255) == 0);
 
-    return textureImage_.get();
+    // New and recycled textures have arbitrary contents; start out transparent. No flush here:
+    // this also runs from GeometryBatch::flush, and pending geometry sets its own target.
+    RenderState &state = window_.getRenderState();
+    state.setTarget(allocation.texture.get());
+    state.setDrawColor(SDL_Color{0, 0, 0, 0});
+    requireSDLCondition(SDL_RenderClear(getRenderer().get()) == 0);
+
+    return allocation;
 }
 
-const Window &Texture::getWindow() const { return window_; }
-const ia::raii::SDL_Renderer &Texture::getRenderer() const { return window_.getRenderer(); }
+void Texture::adopt(TexturePool::Allocation allocation) const {
+    texture_ = std::move(allocation.texture);
+    allocWidth_ = allocation.width;
+    allocHeight_ = allocation.height;
+}
+
+void Texture::reallocate(int capacityWidth, int capacityHeight) {
+    TexturePool::Allocation moved = allocate(capacityWidth, capacityHeight);
+
+    const SDL_Rect kept = {0, 0, std::min(width_, capacityWidth), std::min(height_, capacityHeight)};
+    copyRaw(texture_.get(), kept, moved.texture.get(), kept);
+
+    releaseTexture();
+    adopt(std::move(moved));
+}
+
+void Texture::copyRaw(::SDL_Texture *source, const SDL_Rect &from, ::SDL_Texture *target, const SDL_Rect &to) const {
+    RenderState &state = window_.getRenderState();
+    state.setTarget(target);
+    state.setClipRect(nullptr);
+
+    requireSDLCondition(SDL_SetTextureBlendMode(source, SDL_BLENDMODE_NONE) == 0);
+    const int copied = SDL_RenderCopy(getRenderer().get(), source, &from, &to);
+    requireSDLCondition(SDL_SetTextureBlendMode(source, SDL_BLENDMODE_BLEND) == 0);
+    requireSDLCondition(copied == 0);
+}
+
+void Texture::clearRect(::SDL_Texture *target, SDL_Rect rect) const {
+    RenderState &state = window_.getRenderState();
+    state.setTarget(target);
+    state.setClipRect(nullptr);
+    state.setBlendMode(SDL_BLENDMODE_NONE);
+    state.setDrawColor(SDL_Color{0, 0, 0, 0});
+    requireSDLCondition(SDL_RenderFillRect(getRenderer().get(), &rect) == 0);
+}
+
+::SDL_Texture *Texture::getScratch() const {
+    if (!scratch_.texture) scratch_ = allocate(allocWidth_, allocHeight_);
+    assert(scratch_.width == allocWidth_ && scratch_.height == allocHeight_);
+    return scratch_.texture.get();
+}
+
+void Texture::shrinkToFit() {
+    window_.invoke([this] {
+        if (!texture_) return;
+        if (TexturePool::sizeClass(width_) == allocWidth_ && TexturePool::sizeClass(height_) == allocHeight_) return;
+
+        flushGeometry();
+        reallocate(width_, height_);
+    });
+}
+
+dr4::Vec2f Texture::getCapacity() const {
+    return window_.invoke([this] {
+        return dr4::Vec2f{static_cast<float>(allocWidth_), static_cast<float>(allocHeight_)};
+    });
+}
+
+void Texture::releaseTexture() {
+    if (!texture_) return;
+
+    TexturePool &pool = window_.getTexturePool();
+    pool.release(TexturePool::Allocation{std::move(texture_), format_, allocWidth_, allocHeight_});
+    pool.release(std::move(scratch_));
+    scratch_ = {};
+    allocWidth_ = allocHeight_ = 0;
+}
+
+SDL_Rect Texture::getBounds() const { return SDL_Rect{0, 0, width_, height_}; }
+
+RenderState &Texture::bindAsTarget(const SDL_Rect &clip) const {
+    ::SDL_Texture *target = getTexture();
+    flushGeometry();
+
+    RenderState &state = window_.getRenderState();
+    state.setTarget(target);
+
+    state.setClipRect(&clip);
+    return state;
+}
 
 // ---------------- Line ----------------
 Line::Line(dr4::Vec2f start, dr4::Vec2f end, float thickness, SDL_Color color)
@@ -160,20 +437,22 @@ void Line::DrawOn(dr4::Texture &texture) const {
     try {
         const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
 
-        RendererGuard renderGuard(dstTexture.getRenderer());
-        requireSDLCondition(SDL_SetRenderTarget(dstTexture.getRenderer().get(), dstTexture.texture_.get()) == 0);
+        const float reach = thickness_ / 2 + 1;
+        const SDL_FRect bounds = {
+            dstTexture.zero_.x + std::fmin(start_.x, end_.x) - reach,
+            dstTexture.zero_.y + std::fmin(start_.y, end_.y) - reach,
+            std::fabs(end_.x - start_.x) + 2 * reach,
+            std::fabs(end_.y - start_.y) + 2 * reach
+        };
+        if (dstTexture.culls(bounds)) return;
+
+        Mesh &mesh = dstTexture.beginGeometry();
 
-        SDL_Rect dstClipRect = convertToSDLRect(dstTexture.GetClipRect());
-        dstClipRect.x += dstTexture.GetZero().x;
-        dstClipRect.y += dstTexture.GetZero().y;
-        requireSDLCondition(SDL_RenderSetClipRect(dstTexture.getRenderer().get(), &dstClipRect) == 0);
+        mesh.appendLine(SDL_FPoint{dstTexture.zero_.x + start_.x, dstTexture.zero_.y + start_.y},
+                        SDL_FPoint{dstTexture.zero_.x + end_.x,   dstTexture.zero_.y + end_.y},
+                        thickness_, color_);
 
-        thickLineColor(dstTexture.getRenderer().get(),
-                       dstTexture.zero_.x + start_.x,
-                       dstTexture.zero_.y + start_.y,
-                       dstTexture.zero_.x + end_.x,
-                       dstTexture.zero_.y + end_.y,
-                       thickness_, SDLColorToGfxColor(color_));
+        dstTexture.commitGeometry();
     } catch (const std::bad_cast&) {
         std::throw_with_nested(Dr4Exception("Bad cast in Line::DrawOn"));
     }
@@ -183,16 +462,78 @@ void Line::SetPos(dr4::Vec2f pos) {
     dr4::Vec2f delta = end_ - start_;
     start_ = pos;
     end_ = pos + delta;
+    ++generation_;
 }
 dr4::Vec2f Line::GetPos() const { return start_; }
-void Line::SetStart(dr4::Vec2f start) { start_ = start; }
-void Line::SetEnd(dr4::Vec2f end) { end_ = end; }
-void Line::SetColor(dr4::Color color) { color_ = convertToSDLColor(color); }
-void Line::SetThickness(float thickness) { thickness_ = thickness; }
+void Line::SetStart(dr4::Vec2f start) { start_ = start; ++generation_; }
+void Line::SetEnd(dr4::Vec2f end) { end_ = end; ++generation_; }
+void Line::SetColor(dr4::Color color) { color_ = convertToSDLColor(color); ++generation_; }
+void Line::SetThickness(float thickness) { thickness_ = thickness; ++generation_; }
 dr4::Vec2f Line::GetStart() const { return start_; }
 dr4::Vec2f Line::GetEnd() const { return end_; }
 dr4::Color Line::GetColor() const { return dr4::Color(color_.r, color_.g, color_.b, color_.a); }
 float Line::GetThickness() const { return thickness_; }
+uint64_t Line::getGeneration() const { return generation_; }
+
+// ---------------- Polyline ----------------
+void Polyline::DrawOn(dr4::Texture &texture) const {
+    try {
+        const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
+
+        if (strokeDirty_) {
+            std::vector<SDL_FPoint> points;
+            points.reserve(points_.size());
+            for (const dr4::Vec2f &point : points_) points.push_back(SDL_FPoint{point.x, point.y});
+
+            stroke_.clear();
+            stroke_.appendPolyline(points, thickness_, color_, join_, closed_, miterLimit_);
+            strokeBounds_ = stroke_.getBounds();
+            strokeDirty_ = false;
+        }
+        if (stroke_.empty()) return;
+
+        const SDL_FRect bounds = {dstTexture.zero_.x + pos_.x + strokeBounds_.x,
+                                  dstTexture.zero_.y + pos_.y + strokeBounds_.y,
+                                  strokeBounds_.w, strokeBounds_.h};
+        if (dstTexture.culls(bounds)) return;
+
+        Mesh &mesh = dstTexture.beginGeometry();
+        mesh.appendMesh(stroke_, SDL_FPoint{dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y});
+        dstTexture.commitGeometry();
+    } catch (const std::bad_cast&) {
+        std::throw_with_nested(Dr4Exception("Bad cast in Polyline::DrawOn"));
+    }
+}
+
+void Polyline::SetPos(dr4::Vec2f pos) { pos_ = pos; ++generation_; }
+dr4::Vec2f Polyline::GetPos() const { return pos_; }
+
+void Polyline::setPoints(std::span<const dr4::Vec2f> points) {
+    points_.assign(points.begin(), points.end());
+    strokeDirty_ = true;
+    ++generation_;
+}
+
+void Polyline::addPoint(dr4::Vec2f point) {
+    points_.push_back(point);
+    strokeDirty_ = true;
+    ++generation_;
+}
+
+std::span<const dr4::Vec2f> Polyline::getPoints() const { return points_; }
+
+void Polyline::setColor(dr4::Color color) { color_ = convertToSDLColor(color); strokeDirty_ = true; ++generation_; }
+void Polyline::setThickness(float thickness) { thickness_ = thickness; strokeDirty_ = true; ++generation_; }
+void Polyline::setJoin(LineJoin join) { join_ = join; strokeDirty_ = true; ++generation_; }
+void Polyline::setMiterLimit(float miterLimit) { miterLimit_ = miterLimit; strokeDirty_ = true; ++generation_; }
+void Polyline::setClosed(bool closed) { closed_ = closed; strokeDirty_ = true; ++generation_; }
+
+dr4::Color Polyline::getColor() const { return convertToDr4Color(color_); }
+float Polyline::getThickness() const { return thickness_; }
+LineJoin Polyline::getJoin() const { return join_; }
+float Polyline::getMiterLimit() const { return miterLimit_; }
+bool Polyline::isClosed() const { return closed_; }
+uint64_t Polyline::getGeneration() const { return generation_; }
 
 // ---------------- Circle ----------------
 Circle::Circle(dr4::Vec2f pos, dr4::Vec2f radius, float borderThickness,
@@ -204,59 +545,56 @@ void Circle::DrawOn(dr4::Texture &texture) const {
     try {
         const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
 
-        RendererGuard renderGuard(dstTexture.getRenderer());
-        requireSDLCondition(SDL_SetRenderTarget(dstTexture.getRenderer().get(), dstTexture.texture_.get()) == 0);
+        SDL_FPoint center{dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y};
+        const SDL_FRect bounds = {center.x - radius_.x - 1, center.y - radius_.y - 1,
+                                  2 * radius_.x + 2, 2 * radius_.y + 2};
+        if (dstTexture.culls(bounds)) return;
 
-        SDL_Rect dstClipRect = convertToSDLRect(dstTexture.GetClipRect());
-        dstClipRect.x += dstTexture.GetZero().x;
-        dstClipRect.y += dstTexture.GetZero().y;
-        requireSDLCondition(SDL_RenderSetClipRect(dstTexture.getRenderer().get(), &dstClipRect) == 0);
+        Mesh &mesh = dstTexture.beginGeometry();
 
-        if (borderThickness_ <= 0) {
-            requireSDLCondition(filledEllipseRGBA(dstTexture.getRenderer().get(),
-                dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y,
-                radius_.x, radius_.y, fillColor_.r, fillColor_.g, fillColor_.b, fillColor_.a) == 0);
-            return;
-        }
+        // With antialiasing the solid part stops half a pixel early and the fringe covers the edge.
+        const float fringe = antialiased_ ? 1.0f : 0.0f;
+        SDL_FPoint radius{radius_.x - fringe / 2, radius_.y - fringe / 2};
+        const int segments = Mesh::ellipseSegments(SDL_FPoint{radius_.x, radius_.y});
 
         dr4::Vec2f innerRadius = radius_ - dr4::Vec2f(borderThickness_, borderThickness_);
-        if (innerRadius.x <= 0 || innerRadius.y <= 0) {
-            requireSDLCondition(filledEllipseRGBA(dstTexture.getRenderer().get(),
-                dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y,
-                radius_.x, radius_.y, borderColor_.r, borderColor_.g, borderColor_.b, borderColor_.a) == 0);
-            return;
+        SDL_Color edgeColor = fillColor_;
+        if (borderThickness_ <= 0) {
+            mesh.appendEllipse(center, radius, fillColor_, segments);
+        } else if (innerRadius.x <= 0 || innerRadius.y <= 0) {
+            mesh.appendEllipse(center, radius, borderColor_, segments);
+            edgeColor = borderColor_;
+        } else {
+            // Ring and fill share one segment count so their edges meet exactly.
+            SDL_FPoint inner{innerRadius.x, innerRadius.y};
+            mesh.appendEllipseRing(center, radius, inner, borderColor_, segments);
+            mesh.appendEllipse(center, inner, fillColor_, segments);
+            edgeColor = borderColor_;
         }
 
-        requireSDLCondition(SDL_SetRenderDrawBlendMode(dstTexture.getRenderer().get(), SDL_BLENDMODE_BLEND) == 0);
+        if (antialiased_) mesh.appendEllipseFringe(center, radius, fringe, edgeColor, segments);
 
-        requireSDLCondition(filledEllipseRGBA(dstTexture.getRenderer().get(),
-            dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y,
-            radius_.x, radius_.y, borderColor_.r, borderColor_.g, borderColor_.b, borderColor_.a) == 0);
-
-        requireSDLCondition(SDL_SetRenderDrawBlendMode(dstTexture.getRenderer().get(), SDL_BLENDMODE_NONE) == 0);
-
-        requireSDLCondition(filledEllipseRGBA(dstTexture.getRenderer().get(),
-            dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y,
-            innerRadius.x, innerRadius.y, fillColor_.r, fillColor_.g, fillColor_.b, fillColor_.a) == 0);
-
-        requireSDLCondition(SDL_SetRenderDrawBlendMode(dstTexture.getRenderer().get(), SDL_BLENDMODE_BLEND) == 0);
+        dstTexture.commitGeometry();
     } catch (const std::bad_cast&) {
         std::throw_with_nested(Dr4Exception("Bad cast in Circle::DrawOn"));
     }
 }
 
-void Circle::SetPos(dr4::Vec2f pos) { pos_ = pos; }
+void Circle::SetPos(dr4::Vec2f pos) { pos_ = pos; ++generation_; }
 dr4::Vec2f Circle::GetPos() const { return pos_; }
-void Circle::SetCenter(dr4::Vec2f center) { pos_ = center; }
-void Circle::SetRadius(dr4::Vec2f radius) { radius_ = radius; }
-void Circle::SetFillColor(dr4::Color color) { fillColor_ = convertToSDLColor(color); }
-void Circle::SetBorderColor(dr4::Color color) { borderColor_ = convertToSDLColor(color); }
-void Circle::SetBorderThickness(float thickness) { borderThickness_ = thickness; }
+void Circle::SetCenter(dr4::Vec2f center) { pos_ = center; ++generation_; }
+void Circle::SetRadius(dr4::Vec2f radius) { radius_ = radius; ++generation_; }
+void Circle::SetFillColor(dr4::Color color) { fillColor_ = convertToSDLColor(color); ++generation_; }
+void Circle::SetBorderColor(dr4::Color color) { borderColor_ = convertToSDLColor(color); ++generation_; }
+void Circle::SetBorderThickness(float thickness) { borderThickness_ = thickness; ++generation_; }
 dr4::Vec2f Circle::GetCenter() const { return pos_; }
 dr4::Vec2f Circle::GetRadius() const { return radius_; }
 dr4::Color Circle::GetFillColor() const { return convertToDr4Color(fillColor_); }
 dr4::Color Circle::GetBorderColor() const { return convertToDr4Color(borderColor_); }
 float Circle::GetBorderThickness() const { return borderThickness_; }
+void Circle::setAntialiased(bool antialiased) { antialiased_ = antialiased; ++generation_; }
+bool Circle::isAntialiased() const { return antialiased_; }
+uint64_t Circle::getGeneration() const { return generation_; }
 
 // ---------------- Rectangle ----------------
 Rectangle::Rectangle(dr4::Vec2f pos, dr4::Vec2f size, float borderThickness,
@@ -267,23 +605,22 @@ void Rectangle::DrawOn(dr4::Texture& texture) const {
     try {
         const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
 
-        RendererGuard renderGuard(dstTexture.getRenderer());
-        requireSDLCondition(SDL_SetRenderTarget(dstTexture.getRenderer().get(), dstTexture.texture_.get()) == 0);
+        const SDL_FRect bounds = {
+            dstTexture.zero_.x + std::fmin(rect_.pos.x, rect_.pos.x + rect_.size.x),
+            dstTexture.zero_.y + std::fmin(rect_.pos.y, rect_.pos.y + rect_.size.y),
+            std::fabs(rect_.size.x), std::fabs(rect_.size.y)
+        };
+        if (dstTexture.culls(bounds)) return;
 
-        SDL_Rect dstClipRect = convertToSDLRect(dstTexture.GetClipRect());
-        dstClipRect.x += dstTexture.GetZero().x;
-        dstClipRect.y += dstTexture.GetZero().y;
-        requireSDLCondition(SDL_RenderSetClipRect(dstTexture.getRenderer().get(), &dstClipRect) == 0);
+        Mesh &mesh = dstTexture.beginGeometry();
 
         if (2 * borderThickness_ >= std::fmin(rect_.size.x, rect_.size.y)) {
-            requireSDLCondition(SDL_SetRenderDrawColor(
-                dstTexture.getRenderer().get(), borderColor_.r, borderColor_.g, borderColor_.b, borderColor_.a) == 0);
+            SDL_Rect outerRect = convertToSDLRect(rect_);
+            outerRect.x += dstTexture.zero_.x;
+            outerRect.y += dstTexture.zero_.y;
 
-            SDL_Rect innerRect = convertToSDLRect(rect_);
-            innerRect.x += dstTexture.zero_.x;
-            innerRect.y += dstTexture.zero_.y;
-
-            requireSDLCondition(SDL_RenderFillRect(dstTexture.getRenderer().get(), &innerRect) == 0);
+            mesh.appendRect(convertToSDLFRect(outerRect), borderColor_);
+            dstTexture.commitGeometry();
             return;
         }
 
@@ -293,11 +630,7 @@ void Rectangle::DrawOn(dr4::Texture& texture) const {
             static_cast<int>(rect_.size.x - 2 * borderThickness_),
             static_cast<int>(rect_.size.y - 2 * borderThickness_)
         };
-
-        requireSDLCondition(SDL_SetRenderDrawColor(dstTexture.getRenderer().get(), fillColor_.r, fillColor_.g, fillColor_.b, fillColor_.a) == 0);
-        requireSDLCondition(SDL_RenderFillRect(dstTexture.getRenderer().get(), &innerRect) == 0);
-
-        requireSDLCondition(SDL_SetRenderDrawColor(dstTexture.getRenderer().get(), borderColor_.r, borderColor_.g, borderColor_.b, borderColor_.a) == 0);
+        mesh.appendRect(convertToSDLFRect(innerRect), fillColor_);
 
         SDL_Rect top {
             static_cast<int>(dstTexture.zero_.x + rect_.pos.x),
@@ -305,7 +638,7 @@ void Rectangle::DrawOn(dr4::Texture& texture) const {
             static_cast<int>(rect_.size.x),
             static_cast<int>(borderThickness_)
         };
-        requireSDLCondition(SDL_RenderFillRect(dstTexture.getRenderer().get(), &top) == 0);
+        mesh.appendRect(convertToSDLFRect(top), borderColor_);
 
         SDL_Rect bottom {
             static_cast<int>(dstTexture.zero_.x + rect_.pos.x),
@@ -313,7 +646,7 @@ void Rectangle::DrawOn(dr4::Texture& texture) const {
             static_cast<int>(rect_.size.x),
             static_cast<int>(borderThickness_)
         };
-        requireSDLCondition(SDL_RenderFillRect(dstTexture.getRenderer().get(), &bottom) == 0);
+        mesh.appendRect(convertToSDLFRect(bottom), borderColor_);
 
         SDL_Rect left {
             static_cast<int>(dstTexture.zero_.x + rect_.pos.x),
@@ -321,7 +654,7 @@ void Rectangle::DrawOn(dr4::Texture& texture) const {
             static_cast<int>(borderThickness_),
             static_cast<int>(rect_.size.y - 2 * borderThickness_)
         };
-        requireSDLCondition(SDL_RenderFillRect(dstTexture.getRenderer().get(), &left) == 0);
+        mesh.appendRect(convertToSDLFRect(left), borderColor_);
 
         SDL_Rect right {
             static_cast<int>(dstTexture.zero_.x + rect_.pos.x + rect_.size.x - borderThickness_),
@@ -329,86 +662,210 @@ void Rectangle::DrawOn(dr4::Texture& texture) const {
             static_cast<int>(borderThickness_),
             static_cast<int>(rect_.size.y - 2 * borderThickness_)
         };
-        requireSDLCondition(SDL_RenderFillRect(dstTexture.getRenderer().get(), &right) == 0);
+        mesh.appendRect(convertToSDLFRect(right), borderColor_);
+
+        dstTexture.commitGeometry();
     } catch (const std::bad_cast&) {
         std::throw_with_nested(Dr4Exception("Bad cast in Rectangle::DrawOn"));
     }
 }
 
-void Rectangle::SetPos(dr4::Vec2f pos) { rect_.pos = pos; }
+void Rectangle::SetPos(dr4::Vec2f pos) { rect_.pos = pos; ++generation_; }
 dr4::Vec2f Rectangle::GetPos() const { return rect_.pos; }
-void Rectangle::SetSize(dr4::Vec2f size) { rect_.size = size; }
-void Rectangle::SetFillColor(dr4::Color color) { fillColor_ = convertToSDLColor(color); }
-void Rectangle::SetBorderThickness(float thickness) { borderThickness_ = thickness; }
-void Rectangle::SetBorderColor(dr4::Color color) { borderColor_ = convertToSDLColor(color); }
+void Rectangle::SetSize(dr4::Vec2f size) { rect_.size = size; ++generation_; }
+void Rectangle::SetFillColor(dr4::Color color) { fillColor_ = convertToSDLColor(color); ++generation_; }
+void Rectangle::SetBorderThickness(float thickness) { borderThickness_ = thickness; ++generation_; }
+void Rectangle::SetBorderColor(dr4::Color color) { borderColor_ = convertToSDLColor(color); ++generation_; }
 dr4::Vec2f Rectangle::GetSize() const { return rect_.size; }
 dr4::Color Rectangle::GetFillColor() const { return convertToDr4Color(fillColor_); }
 float Rectangle::GetBorderThickness() const { return borderThickness_; }
 dr4::Color Rectangle::GetBorderColor() const { return convertToDr4Color(borderColor_); }
+uint64_t Rectangle::getGeneration() const { return generation_; }
 
 // ---------------- Font ----------------
-Font::Font() = default;
-Font::~Font() = default;
+Font::Font(std::shared_ptr<FontFaceRegistry> registry, const Window *window)
+    : registry_(std::move(registry)), window_(window) {}
+
+Font::~Font() {
+    if (!window_) return;
+    if (!CommandList::getActive()) {
+        // Queued text takes mutex_ on the render thread, so it must not be held while waiting.
+        window_->invoke([this] { resetFont(); });
+        return;
+    }
+
+    std::lock_guard lock(mutex_);
+    dropFaceCaches();
+    window_->record([fonts = std::move(sizedFonts_), face = std::move(face_)]() mutable {
+        fonts.clear();
+        face.reset();
+    }, this);
+}
 
 void Font::resetFont() {
-    font_.reset();
-    lastLoadBufer.reset();
+    std::lock_guard lock(mutex_);
+    dropFaceCaches();
+    sizedFonts_.clear();
+    metrics_.clear();
+    face_.reset();
+}
+
+void Font::dropFaceCaches() const {
+    // Faces from a registry may be shared with other fonts still drawing from the caches.
+    if (!window_ || !face_ || face_.use_count() > 1) return;
+
+    // Recorded, not invoked: the render thread may be waiting for mutex_.
+    window_->record([window = window_, faceId = face_->getId()] {
+        window->getTextCache().invalidateFace(faceId);
+        window->getGlyphAtlases().invalidateFace(faceId);
+    });
+}
+
+int Font::toPointSize(float fontSize) {
+    return std::max(1, static_cast<int>(fontSize));
+}
+
+void Font::openFace() {
+    // Opening the default size up front validates the face data.
+    try {
+        getHandle(static_cast<float>(fontSize_));
+    } catch (...) {
+        resetFont();
+        throw;
+    }
 }
 
 void Font::LoadFromFile(const std::string& path) {
+    // Text recorded before the load still draws with the old face.
+    if (window_) window_->finish();
+    std::lock_guard lock(mutex_);
     resetFont();
 
     lastFileLoadpath = path;
-    std::string fontPath = lastFileLoadpath.value_or(std::string{});
-    
-    font_ = raii::TTF_OpenFont(fontPath.c_str(), fontSize_);
-    requireTTFCondition(font_ != nullptr);
+    face_ = registry_ ? registry_->acquireFile(path) : FontFace::mapFile(path);
+    openFace();
 }
 
 void Font::LoadFromBuffer(const void *buffer, size_t size) {
     assert(buffer);
+    if (window_) window_->finish();
+    std::lock_guard lock(mutex_);
     resetFont();
 
-    lastLoadBufer = raii::SDL_RWFromConstMem(buffer, size);
-    requireSDLCondition(lastLoadBufer != nullptr);
-    font_ = raii::TTF_OpenFontRW(lastLoadBufer.get(), 0, fontSize_);
-    if (!font_) {
-        resetFont();
-        throw TTFException();
+    face_ = registry_ ? registry_->acquireBuffer(buffer, size) : FontFace::copyBuffer(buffer, size);
+    openFace();
+}
+
+::TTF_Font *Font::getHandle(float fontSize) const {
+    std::lock_guard lock(mutex_);
+    requireTTFCondition(isLoaded(), "font wasn't loaded");
+
+    const int pointSize = toPointSize(fontSize);
+    for (auto it = sizedFonts_.begin(); it != sizedFonts_.end(); ++it) {
+        if (it->first != pointSize) continue;
+        if (it != sizedFonts_.begin()) sizedFonts_.splice(sizedFonts_.begin(), sizedFonts_, it);
+        return sizedFonts_.front().second.get();
     }
+
+    raii::SDL_RWops src = raii::SDL_RWFromConstMem(face_->data(), face_->size());
+    requireSDLCondition(src != nullptr);
+
+    // freesrc = 1: the font owns the RWops from here on, even if opening fails.
+    raii::TTF_Font handle = raii::TTF_OpenFontRW(src.release(), 1, pointSize);
+    requireTTFCondition(handle != nullptr);
+
+    sizedFonts_.emplace_front(pointSize, std::move(handle));
+    if (sizedFonts_.size() > MAX_CACHED_SIZES) sizedFonts_.pop_back();
+
+    return sizedFonts_.front().second.get();
 }
 
-float Font::GetAscent(float fontSize) const {
-    setFontSizeDetail(fontSize);
-    float fontAscent = static_cast<float>(TTF_FontAscent(font_.get()));
-    setFontSizeDetail(fontSize_);
+const Font::Metrics &Font::getMetrics(float fontSize) const {
+    return getMetricsDetail(toPointSize(fontSize));
+}
 
-    return fontAscent;
+Font::Metrics &Font::getMetricsDetail(int pointSize) const {
+    std::lock_guard lock(mutex_);
+    auto it = metrics_.find(pointSize);
+    if (it != metrics_.end()) return it->second;
+
+    ::TTF_Font *handle = getHandle(static_cast<float>(pointSize));
+
+    Metrics metrics;
+    metrics.ascent   = TTF_FontAscent(handle);
+    metrics.descent  = TTF_FontDescent(handle);
+    metrics.height   = TTF_FontHeight(handle);
+    metrics.lineSkip = TTF_FontLineSkip(handle);
+    metrics.kerning  = TTF_GetFontKerning(handle) != 0;
+
+    for (Uint32 codepoint = 0; codepoint < Metrics::ASCII_TABLE_SIZE; ++codepoint) {
+        int advance = 0;
+        if (TTF_GlyphMetrics32(handle, codepoint, nullptr, nullptr, nullptr, nullptr, &advance) == 0)
+            metrics.asciiAdvances[codepoint] = advance;
+    }
+
+    return metrics_.emplace(pointSize, std::move(metrics)).first->second;
 }
 
-float Font::GetDescent(float fontSize) const {
-    setFontSizeDetail(fontSize);
-    float fontDescent = static_cast<float>(TTF_FontDescent(font_.get()));
-    setFontSizeDetail(fontSize_);
+int Font::getAdvance(float fontSize, Uint32 codepoint) const {
+    std::lock_guard lock(mutex_);
+    const int pointSize = toPointSize(fontSize);
+    Metrics &metrics = getMetricsDetail(pointSize);
+    if (codepoint < Metrics::ASCII_TABLE_SIZE) return metrics.asciiAdvances[codepoint];
+
+    auto it = metrics.advances.find(codepoint);
+    if (it != metrics.advances.end()) return it->second;
 
-    return fontDescent;
+    int advance = 0;
+    if (TTF_GlyphMetrics32(getHandle(static_cast<float>(pointSize)), codepoint,
+                           nullptr, nullptr, nullptr, nullptr, &advance) != 0) advance = 0;
+    metrics.advances.emplace(codepoint, advance);
+    return advance;
 }
 
-float Font::getFontSize() const { return static_cast<float>(fontSize_); }
+int Font::getKerning(float fontSize, Uint32 left, Uint32 right) const {
+    std::lock_guard lock(mutex_);
+    const int pointSize = toPointSize(fontSize);
+    Metrics &metrics = getMetricsDetail(pointSize);
+    if (!metrics.kerning) return 0;
+
+    const uint64_t pair = (static_cast<uint64_t>(left) << 32) | right;
+    auto it = metrics.kerningPairs.find(pair);
+    if (it != metrics.kerningPairs.end()) return it->second;
 
-void Font::setFontSizeDetail(float fontSize) const {
-    requireTTFCondition(TTF_SetFontSize(font_.get(), fontSize) == 0);    
+    int kerning = TTF_GetFontKerningSizeGlyphs32(getHandle(static_cast<float>(pointSize)), left, right);
+    metrics.kerningPairs.emplace(pair, kerning);
+    return kerning;
 }
 
-void Font::setFontSize(float fontSize) {
-    requireTTFCondition(TTF_SetFontSize(font_.get(), fontSize) == 0);    
+dr4::Vec2f Font::measure(std::string_view text, float fontSize) const {
+    std::lock_guard lock(mutex_);
+    const Metrics &metrics = getMetrics(fontSize);
+
+    int width = 0;
+    Uint32 prev = 0;
+    for (Uint32 codepoint : decodeUTF8(text)) {
+        if (prev != 0) width += getKerning(fontSize, prev, codepoint);
+        width += getAdvance(fontSize, codepoint);
+        prev = codepoint;
+    }
+
+    return dr4::Vec2f(static_cast<float>(width), static_cast<float>(metrics.height));
 }
 
-// ---------------- FontGuard ----------------
-FontGuard::FontGuard(Font *font): font_(font), savedFontSize_(font ? font->getFontSize() : 0) {
-    assert(font);
+float Font::GetAscent(float fontSize) const {
+    return static_cast<float>(getMetrics(fontSize).ascent);
+}
+
+float Font::GetDescent(float fontSize) const {
+    return static_cast<float>(getMetrics(fontSize).descent);
 }
-FontGuard::~FontGuard() { font_->setFontSize(savedFontSize_); }
+
+float Font::getFontSize() const { return static_cast<float>(fontSize_); }
+void Font::setFontSize(float fontSize) { fontSize_ = toPointSize(fontSize); }
+
+uint64_t Font::getFaceId() const { return face_ ? face_->getId() : 0; }
+bool Font::isLoaded() const { return face_ != nullptr; }
 
 // ---------------- Text ----------------
 Text::Text(const Font *font) {
@@ -422,49 +879,81 @@ void Text::DrawOn(dr4::Texture& texture) const {
             std::cerr << "font wasn't set\n";
             return;
         }
-        if (font_->font_ == nullptr) {
+        if (!font_->isLoaded()) {
             std::cerr << "text font wasn't loaded\n";
             return;
         }
 
         const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
-        RendererGuard renderGuard(dstTexture.getRenderer());
-        FontGuard fontGuard(font_);
-
-        requireSDLCondition(SDL_SetRenderTarget(dstTexture.getRenderer().get(), dstTexture.texture_.get()) == 0);
 
-        SDL_Rect dstClipRect = convertToSDLRect(dstTexture.GetClipRect());
-        dstClipRect.x += dstTexture.GetZero().x;
-        dstClipRect.y += dstTexture.GetZero().y;
-        requireSDLCondition(SDL_RenderSetClipRect(dstTexture.getRenderer().get(), &dstClipRect) == 0);
+        int x = dstTexture.zero_.x + pos_.x;
+        int y = dstTexture.zero_.y + pos_.y;
+
+        // Padded by half a line on the sides for overhanging glyphs.
+        const Font::Metrics &metrics = font_->getMetrics(fontSize_);
+        const dr4::Vec2f size = GetBounds();
+        const float height = std::fmax(size.y, static_cast<float>(metrics.height));
+        const float pad = static_cast<float>(metrics.height) / 2;
+        const SDL_FRect bounds = {x - pad, static_cast<float>(y + valignOffset(vAlign_, static_cast<int>(height), metrics.ascent)),
+                                  size.x + 2 * pad, height};
+        if (dstTexture.culls(bounds)) return;
+
+        auto draw = [&dstTexture, font = font_, fontSize = fontSize_, mode = renderMode_, x, y,
+                     valign = vAlign_, color = color_, clip = dstTexture.getTargetClipRect()](const std::string &text) {
+            // Keeps the app thread from evicting the TTF_Font in use.
+            std::lock_guard lock(font->mutex_);
+            dstTexture.bindAsTarget(clip);
+            if (mode == RenderMode::GLYPH_ATLAS) {
+                DrawGlyphRun(dstTexture.getRenderer(), dstTexture.getWindow().getGlyphAtlases(),
+                             font, fontSize, text, x, y, valign, color);
+            } else {
+                DrawTextDetail(dstTexture.getRenderer(), dstTexture.getWindow().getTextCache(),
+                               font, fontSize, text.c_str(), x, y, valign, color);
+            }
+        };
 
-        DrawTextDetail(dstTexture.getRenderer(), font_, text_.c_str(),
-                       dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y, vAlign_, color_);
+        const Window &window = dstTexture.getWindow();
+        if (window.defersCommands()) {
+            window.record([draw, text = text_] { draw(text); }, &dstTexture);
+        } else {
+            draw(text_);
+        }
     } catch (const std::bad_cast&) {
         std::throw_with_nested(Dr4Exception("Bad cast in Text::DrawOn"));
     }
 }
 
-void Text::SetPos(dr4::Vec2f pos) { pos_ = pos; }
+void Text::SetPos(dr4::Vec2f pos) { pos_ = pos; ++generation_; }
 dr4::Vec2f Text::GetPos() const { return pos_; }
 
-void Text::SetText(const std::string &text) { text_ = text; }
-void Text::SetColor(dr4::Color color) { color_ = convertToSDLColor(color); }
-void Text::SetFontSize(float size) { fontSize_ = size; }
-void Text::SetVAlign(dr4::Text::VAlign align) { vAlign_ = align; }
+void Text::SetText(const std::string &text) {
+    if (text == text_) return;
+    text_ = text;
+    cachedBounds_.reset();
+    ++generation_;
+}
+void Text::SetColor(dr4::Color color) { color_ = convertToSDLColor(color); ++generation_; }
+void Text::SetFontSize(float size) {
+    fontSize_ = size;
+    cachedBounds_.reset();
+    ++generation_;
+}
+void Text::SetVAlign(dr4::Text::VAlign align) { vAlign_ = align; ++generation_; }
 
 void Text::SetFont(const dr4::Font *font) {
     auto f = dynamic_cast<const Font*>(font);
     if (!f) { std::throw_with_nested(Dr4Exception("Bad cast in Text::SetFont")); }
     font_ = const_cast<Font *>(f);
+    cachedBounds_.reset();
+    ++generation_;
 }
 
 dr4::Vec2f Text::GetBounds() const {
-    FontGuard fontGuard(font_);
-    font_->setFontSize(fontSize_);
-    int textWidth = 0, textHeight = 0;
-    requireTTFCondition(TTF_SizeUTF8(font_->font_.get(), text_.c_str(), &textWidth, &textHeight) == 0);
-    return dr4::Vec2f(static_cast<float>(textWidth), static_cast<float>(textHeight));
+    if (cachedBounds_ && cachedBoundsFaceId_ == font_->getFaceId()) return *cachedBounds_;
+
+    cachedBounds_ = font_->measure(text_, fontSize_);
+    cachedBoundsFaceId_ = font_->getFaceId();
+    return *cachedBounds_;
 }
 
 const std::string &Text::GetText() const { return text_; }
@@ -473,33 +962,112 @@ float Text::GetFontSize() const { return fontSize_; }
 Text::VAlign Text::GetVAlign() const { return vAlign_; }
 const Font *Text::GetFont() const { return font_; }
 
-void Text::DrawTextDetail(const raii::SDL_Renderer &renderer, 
-                          Font *font, const char* text,
-                          int x, int y, VAlign valign, SDL_Color color) const
+void Text::setRenderMode(RenderMode mode) { renderMode_ = mode; ++generation_; }
+Text::RenderMode Text::getRenderMode() const { return renderMode_; }
+
+uint64_t Text::getGeneration() const {
+    // Reloading the font changes the face without going through the Text.
+    const uint64_t faceId = font_ ? font_->getFaceId() : 0;
+    if (faceId != generationFaceId_) {
+        generationFaceId_ = faceId;
+        ++generation_;
+    }
+    return generation_;
+}
+
+void Text::DrawTextDetail(const raii::SDL_Renderer &renderer, TextTextureCache &textCache,
+                          Font *font, float fontSize, const char* text,
+                          int x, int y, VAlign valign, SDL_Color color)
 {
-    font->setFontSize(fontSize_);
+    ::TTF_Font *ttfFont = font->getHandle(fontSize);
 
-    raii::SDL_Surface surf = raii::TTF_RenderUTF8_Blended(font->font_, text, color);
-    if (!surf) surf = raii::TTF_RenderUTF8_Blended(font->font_, " ", color); 
-    requireSDLCondition(surf != nullptr);
+    TextCacheKey key{font->getFaceId(), Font::toPointSize(fontSize), SDLColorToGfxColor(color), text};
+    const TextTextureCache::Entry *entry = textCache.find(key);
+    if (!entry) {
+        raii::SDL_Surface surf = raii::TTF_RenderUTF8_Blended(ttfFont, text, color);
+        if (!surf) surf = raii::TTF_RenderUTF8_Blended(ttfFont, " ", color); 
+        requireSDLCondition(surf != nullptr);
 
-    raii::SDL_Texture tex = raii::SDL_CreateTextureFromSurface(renderer, surf);
-    requireSDLCondition(tex != nullptr);
+        raii::SDL_Texture tex = raii::SDL_CreateTextureFromSurface(renderer, surf);
+        requireSDLCondition(tex != nullptr);
 
-    int w = 0, h = 0;
-    requireSDLCondition(SDL_QueryTexture(tex.get(), NULL, NULL, &w, &h) == 0);
+        entry = &textCache.insert(std::move(key), std::move(tex));
+    }
 
-    SDL_Rect dst = { x, y, w, h };
+    int w = entry->width, h = entry->height;
+    SDL_Rect dst = { x, y + valignOffset(valign, h, font->getMetrics(fontSize).ascent), w, h };
 
-    switch (valign) {
-        case VAlign::TOP:        break;
-        case VAlign::MIDDLE:     dst.y -= h / 2; break;
-        case VAlign::BASELINE:   dst.y -= TTF_FontAscent(font->font_.get()); break;
-        case VAlign::BOTTOM:     dst.y -= h; break;
-        default: break;
+    requireSDLCondition(SDL_RenderCopy(renderer.get(), entry->texture.get(), nullptr, &dst) == 0);
+}
+
+void Text::DrawGlyphRun(const raii::SDL_Renderer &renderer, GlyphAtlasCache &atlases,
+                        Font *font, float fontSize, std::string_view text,
+                        int x, int y, VAlign valign, SDL_Color color)
+{
+    ::TTF_Font *ttfFont = font->getHandle(fontSize);
+
+    GlyphAtlas &atlas = atlases.get(font->getFaceId(), Font::toPointSize(fontSize));
+    const Font::Metrics &metrics = font->getMetrics(fontSize);
+    y += valignOffset(valign, metrics.height, metrics.ascent);
+
+    struct PageBatch {
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+    };
+    std::vector<PageBatch> batches;
+
+    const float invPageSize = 1.0f / GlyphAtlas::PAGE_SIZE;
+
+    int penX = x;
+    Uint32 prev = 0;
+    for (Uint32 codepoint : decodeUTF8(text)) {
+        if (prev != 0) penX += font->getKerning(fontSize, prev, codepoint);
+        prev = codepoint;
+
+        const GlyphAtlas::Glyph &glyph = atlas.getGlyph(renderer, ttfFont, codepoint);
+        if (glyph.rect.w > 0 && glyph.rect.h > 0) {
+            if (batches.size() < atlas.getPageCount()) batches.resize(atlas.getPageCount());
+            PageBatch &batch = batches[glyph.page];
+
+            float left   = static_cast<float>(penX + glyph.offsetX);
+            float top    = static_cast<float>(y);
+            float right  = left + glyph.rect.w;
+            float bottom = top + glyph.rect.h;
+
+            float u0 = glyph.rect.x * invPageSize;
+            float v0 = glyph.rect.y * invPageSize;
+            float u1 = (glyph.rect.x + glyph.rect.w) * invPageSize;
+            float v1 = (glyph.rect.y + glyph.rect.h) * invPageSize;
+
+            int base = static_cast<int>(batch.vertices.size());
+            batch.vertices.push_back(SDL_Vertex{SDL_FPoint{left,  top},    color, SDL_FPoint{u0, v0}});
+            batch.vertices.push_back(SDL_Vertex{SDL_FPoint{right, top},    color, SDL_FPoint{u1, v0}});
+            batch.vertices.push_back(SDL_Vertex{SDL_FPoint{right, bottom}, color, SDL_FPoint{u1, v1}});
+            batch.vertices.push_back(SDL_Vertex{SDL_FPoint{left,  bottom}, color, SDL_FPoint{u0, v1}});
+            for (int offset : {0, 1, 2, 0, 2, 3}) batch.indices.push_back(base + offset);
+        }
+
+        penX += glyph.advance;
+    }
+
+    for (size_t page = 0; page < batches.size(); ++page) {
+        const PageBatch &batch = batches[page];
+        if (batch.indices.empty()) continue;
+
+        requireSDLCondition(SDL_RenderGeometry(renderer.get(), atlas.getPage(static_cast<int>(page)),
+                                               batch.vertices.data(), static_cast<int>(batch.vertices.size()),
+                                               batch.indices.data(), static_cast<int>(batch.indices.size())) == 0);
     }
+}
 
-    requireSDLCondition(SDL_RenderCopy(renderer.get(), tex.get(), nullptr, &dst) == 0);
+int Text::valignOffset(VAlign valign, int height, int ascent) {
+    switch (valign) {
+        case VAlign::TOP:        return 0;
+        case VAlign::MIDDLE:     return -height / 2;
+        case VAlign::BASELINE:   return -ascent;
+        case VAlign::BOTTOM:     return -height;
+        default:                 return 0;
+    }
 }
 
 // ---------------- Image ----------------
@@ -511,75 +1079,240 @@ Image::Image(int width, int height) {
     surface_ = createSDLSurface(width, height);
 }
 
-Image::~Image() = default;
+Image::~Image() {
+    if (streamOwner_.expired()) {
+        releaseStreamTexture();
+        return;
+    }
+    if (!CommandList::getActive()) {
+        streamWindow_->invoke([this] { releaseStreamTexture(); });
+        return;
+    }
+
+    streamWindow_->record([texture = std::move(streamTexture_), owner = std::move(streamOwner_)]() mutable {
+        // The renderer may have gone since; then it freed the texture already.
+        if (owner.expired()) (void)texture.release();
+        texture.reset();
+    }, this);
+}
 
 void Image::DrawOn(dr4::Texture &texture) const try {
     const Texture &dstTexture = dynamic_cast<const Texture &>(texture);
+    if (dstTexture.culls(SDL_FRect{dstTexture.zero_.x + pos_.x, dstTexture.zero_.y + pos_.y,
+                                   static_cast<float>(surface_->w), static_cast<float>(surface_->h)})) {
+        return;
+    }
 
-    RendererGuard renderGuard(dstTexture.getRenderer());
-    requireSDLCondition(SDL_SetRenderTarget(dstTexture.getRenderer().get(), dstTexture.texture_.get()) == 0);
-
-    SDL_Rect dstClipRect = convertToSDLRect(dstTexture.GetClipRect());
-    dstClipRect.x += dstTexture.GetZero().x;
-    dstClipRect.y += dstTexture.GetZero().y;
-    requireSDLCondition(SDL_RenderSetClipRect(dstTexture.getRenderer().get(), &dstClipRect) == 0);
-
-    raii::SDL_Texture surfTex = raii::SDL_CreateTextureFromSurface(dstTexture.getRenderer(), surface_);
-    requireSDLCondition(surfTex != nullptr);
-
+    const Window &window = dstTexture.getWindow();
     SDL_Rect dst = {
         static_cast<int>(dstTexture.zero_.x + pos_.x),
         static_cast<int>(dstTexture.zero_.y + pos_.y),
         surface_->w,
         surface_->h
     };
-    requireSDLCondition(SDL_RenderCopy(dstTexture.getRenderer().get(), surfTex.get(), nullptr, &dst) == 0);
+    auto draw = [this, &dstTexture, dst, clip = dstTexture.getTargetClipRect()](const StreamUpdate &update,
+                                                                                  const SDL_Surface *pixels) {
+        dstTexture.bindAsTarget(clip);
+        applyStreamUpdate(dstTexture.getWindow(), update, pixels);
+        requireSDLCondition(SDL_RenderCopy(dstTexture.getRenderer().get(), streamTexture_.get(), nullptr, &dst) == 0);
+    };
+
+    StreamUpdate update = takeStreamUpdate(window);
+    if (!window.defersCommands()) {
+        draw(update, surface_.get());
+        return;
+    }
+
+    // The upload is a command of its own that draws to the image, so a merged command
+    // list keeps it ahead of the draws that read the image. The surface may change before
+    // it runs, so dirty pixels travel with it.
+    if (update.recreate || !update.rects.empty()) {
+        raii::SDL_Surface snapshot = createSDLSurface(surface_->w, surface_->h);
+        std::memcpy(snapshot->pixels, surface_->pixels, static_cast<size_t>(surface_->pitch) * surface_->h);
+        window.record([this, &window, update = std::move(update), snapshot = std::move(snapshot)] {
+            applyStreamUpdate(window, update, snapshot.get());
+        }, this);
+    }
+    window.record([draw] { draw(StreamUpdate{}, nullptr); }, &dstTexture, this);
 } catch (const std::bad_cast&) { std::throw_with_nested(Dr4Exception("Bad cast in Image::DrawOn")); }
 
-void Image::SetPos(dr4::Vec2f pos) { pos_ = pos; }
+void Image::SetPos(dr4::Vec2f pos) { pos_ = pos; ++generation_; }
 dr4::Vec2f Image::GetPos() const { return pos_; }
 
 void Image::SetPixel(size_t x, size_t y, dr4::Color color) {
     if (!surface_) return;
     if (x >= static_cast<size_t>(surface_->w) || y >= static_cast<size_t>(surface_->h)) return;
 
-    SDL_LockSurface(surface_.get());
+    rowData(y)[x] = color;
+    markDirty(SDL_Rect{static_cast<int>(x), static_cast<int>(y), 1, 1});
+}
 
-    Uint8* pixel_ptr = static_cast<Uint8*>(surface_->pixels) + y * surface_->pitch + x * surface_->format->BytesPerPixel;
-    Uint32 mapped = SDL_MapRGBA(surface_->format, color.r, color.g, color.b, color.a);
-    *reinterpret_cast<Uint32*>(pixel_ptr) = mapped;
+dr4::Color Image::GetPixel(size_t x, size_t y) const {
+    assert(x < static_cast<size_t>(surface_->w) && y < static_cast<size_t>(surface_->h));
+    return rowData(y)[x];
+}
 
-    SDL_UnlockSurface(surface_.get());
+PixelView<const dr4::Color> Image::getPixels() const {
+    return makePixelView<const dr4::Color>(rowData(0), surface_->h, surface_->w, rowStride());
 }
 
-dr4::Color Image::GetPixel(size_t x, size_t y) const {
-    assert(surface_->format->BytesPerPixel == 4);
-    assert(sizeof(dr4::Color) == 4);
+PixelView<dr4::Color> Image::editPixels() {
+    markDirty();
+    return makePixelView<dr4::Color>(rowData(0), surface_->h, surface_->w, rowStride());
+}
 
-    Uint8* pixel_ptr = static_cast<Uint8*>(surface_->pixels)
-                        + y * surface_->pitch
-                        + x * (surface_->format->BytesPerPixel);
+std::span<const dr4::Color> Image::getRow(size_t y) const {
+    assert(y < static_cast<size_t>(surface_->h));
+    return {rowData(y), static_cast<size_t>(surface_->w)};
+}
 
-    return *reinterpret_cast<dr4::Color*>(pixel_ptr);
+std::span<dr4::Color> Image::editRow(size_t y) {
+    assert(y < static_cast<size_t>(surface_->h));
+    markDirty(SDL_Rect{0, static_cast<int>(y), surface_->w, 1});
+    return {rowData(y), static_cast<size_t>(surface_->w)};
+}
+
+void Image::fillRect(SDL_Rect rect, dr4::Color color) {
+    const SDL_Rect bounds = {0, 0, surface_->w, surface_->h};
+    SDL_Rect clipped{};
+    if (!SDL_IntersectRect(&rect, &bounds, &clipped)) return;
+
+    dr4::Color *first = rowData(clipped.y) + clipped.x;
+    std::fill_n(first, clipped.w, color);
+    for (int y = clipped.y + 1; y < clipped.y + clipped.h; ++y) {
+        std::memcpy(rowData(y) + clipped.x, first, clipped.w * sizeof(dr4::Color));
+    }
+    dirty_.add(clipped);
+    ++generation_;
 }
 
+void Image::writePixels(SDL_Rect rect, std::span<const dr4::Color> pixels) {
+    if (rect.w <= 0 || rect.h <= 0) return;
+    if (pixels.size() < static_cast<size_t>(rect.w) * static_cast<size_t>(rect.h)) {
+        throw Dr4Exception("Image::writePixels : span is smaller than the rect");
+    }
+
+    const SDL_Rect bounds = {0, 0, surface_->w, surface_->h};
+    SDL_Rect clipped{};
+    if (!SDL_IntersectRect(&rect, &bounds, &clipped)) return;
+
+    const dr4::Color *src = pixels.data() + static_cast<size_t>(clipped.y - rect.y) * rect.w + (clipped.x - rect.x);
+    for (int y = clipped.y; y < clipped.y + clipped.h; ++y, src += rect.w) {
+        std::memcpy(rowData(y) + clipped.x, src, clipped.w * sizeof(dr4::Color));
+    }
+    dirty_.add(clipped);
+    ++generation_;
+}
+
+dr4::Color *Image::rowData(size_t y) const {
+    static_assert(sizeof(dr4::Color) == 4);
+    assert(surface_->format->format == CANONICAL_PIXEL_FORMAT);
+    return reinterpret_cast<dr4::Color *>(static_cast<Uint8 *>(surface_->pixels) + y * surface_->pitch);
+}
+
+size_t Image::rowStride() const { return static_cast<size_t>(surface_->pitch) / sizeof(dr4::Color); }
+
 void Image::SetSize(dr4::Vec2f size) {
     assert(surface_);
     raii::SDL_Surface newSurface = createSDLSurface(static_cast<int>(size.x), static_cast<int>(size.y));
     requireSDLCondition(newSurface != nullptr);
     surface_ = std::move(newSurface);
+    markDirty();
 }
 
 dr4::Vec2f Image::GetSize() const { return dr4::Vec2f{static_cast<float>(surface_->w), static_cast<float>(surface_->h)}; }
 float Image::GetWidth() const { return static_cast<float>(surface_->w); }
 float Image::GetHeight() const { return static_cast<float>(surface_->h); }
+uint64_t Image::getGeneration() const { return generation_; }
+
+void Image::markDirty(SDL_Rect rect) {
+    const SDL_Rect bounds = {0, 0, surface_->w, surface_->h};
+    SDL_Rect clipped{};
+    if (SDL_IntersectRect(&rect, &bounds, &clipped)) dirty_.add(clipped);
+    ++generation_;
+}
+
+void Image::markDirty() {
+    dirty_.add(SDL_Rect{0, 0, surface_->w, surface_->h});
+    ++generation_;
+}
+
+Image::StreamUpdate Image::takeStreamUpdate(const Window &window) const {
+    StreamUpdate update;
+    update.size = SDL_Point{surface_->w, surface_->h};
+
+    const std::shared_ptr<const void> &owner = window.getRendererToken();
+    if (streamOwner_.lock() != owner || streamSize_.x != surface_->w || streamSize_.y != surface_->h) {
+        update.recreate = true;
+        update.ownerExpired = streamOwner_.expired();
+        streamOwner_ = owner;
+        streamWindow_ = &window;
+        streamSize_ = update.size;
+
+        dirty_.clear();
+        dirty_.add(SDL_Rect{0, 0, surface_->w, surface_->h});
+    }
+
+    std::span<const SDL_Rect> rects = dirty_.getRects();
+    update.rects.assign(rects.begin(), rects.end());
+    dirty_.clear();
+    return update;
+}
+
+void Image::applyStreamUpdate(const Window &window, const StreamUpdate &update, const SDL_Surface *pixels) const {
+    if (update.recreate) {
+        if (update.ownerExpired) (void)streamTexture_.release();
+        streamTexture_ = raii::SDL_CreateTexture(window.getRenderer(), window.getTextureFormat(),
+                                                 SDL_TEXTUREACCESS_STREAMING, update.size.x, update.size.y);
+        requireSDLCondition(streamTexture_ != nullptr);
+        requireSDLCondition(SDL_SetTextureBlendMode(streamTexture_.get(), SDL_BLENDMODE_BLEND) == 0);
+    }
+    if (update.rects.empty()) return;
+    assert(pixels);
+
+    const Uint32 textureFormat = window.getTextureFormat();
+    const Uint8 *data = static_cast<const Uint8 *>(pixels->pixels);
+    for (const SDL_Rect &rect : update.rects) {
+        void *locked = nullptr;
+        int lockedPitch = 0;
+        requireSDLCondition(SDL_LockTexture(streamTexture_.get(), &rect, &locked, &lockedPitch) == 0);
+
+        const Uint8 *origin = data + rect.y * pixels->pitch + rect.x * pixels->format->BytesPerPixel;
+        convertPixels(origin, pixels->pitch, CANONICAL_PIXEL_FORMAT,
+                      locked, lockedPitch, textureFormat, rect.w, rect.h);
+        SDL_UnlockTexture(streamTexture_.get());
+    }
+}
+
+bool Image::readTarget(const Window &window, SDL_Rect area) {
+    if (surface_->w != area.w || surface_->h != area.h) surface_ = createSDLSurface(area.w, area.h);
+
+    // Read in the renderer's own format so SDL does not convert, then convert here.
+    const Uint32 textureFormat = window.getTextureFormat();
+    if (SDL_RenderReadPixels(window.getRenderer().get(), &area, textureFormat,
+                             surface_->pixels, surface_->pitch) != 0) {
+        return false;
+    }
+    convertPixels(surface_->pixels, surface_->pitch, textureFormat,
+                  surface_->pixels, surface_->pitch, CANONICAL_PIXEL_FORMAT, area.w, area.h);
+
+    markDirty();
+    return true;
+}
+
+void Image::releaseStreamTexture() const {
+    // A texture outliving its renderer was freed together with it.
+    if (streamOwner_.expired()) (void)streamTexture_.release();
+    streamTexture_.reset();
+    streamOwner_.reset();
+}
 
 raii::SDL_Surface Image::createSDLSurface(int width, int height) {
     raii::SDL_Surface result = raii::SDL_CreateRGBSurfaceWithFormat(
         0,
         width, height,
         BIT_PER_PIXEL,
-        SDL_PIXELFORMAT_RGBA32
+        CANONICAL_PIXEL_FORMAT
     );
 
     requireSDLCondition(result != nullptr);
@@ -0,0 +1,147 @@
+#include "FontFace.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <SDL2/SDL.h>
+
+#include "IAError.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ia {
+
+// ---------------- FontFace ----------------
+FontFace::FontFace() {
+    static std::atomic<uint64_t> counter{0};
+    id_ = ++counter;
+}
+
+FontFace::~FontFace() {
+#if !defined(_WIN32)
+    if (mapped_) munmap(const_cast<unsigned char *>(data_), size_);
+#endif
+}
+
+std::shared_ptr<const FontFace> FontFace::mapFile(const std::string &path) {
+    std::shared_ptr<FontFace> face(new FontFace());
+
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw SDLException("can't open font file " + path + ": " + std::strerror(errno));
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        throw SDLException("can't stat font file " + path);
+    }
+
+    void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) throw SDLException("can't map font file " + path + ": " + std::strerror(errno));
+
+    face->data_ = static_cast<const unsigned char *>(mapping);
+    face->size_ = static_cast<size_t>(info.st_size);
+    face->mapped_ = true;
+#else
+    size_t size = 0;
+    void *data = SDL_LoadFile(path.c_str(), &size);
+    requireSDLCondition(data != nullptr);
+
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    face->owned_.assign(bytes, bytes + size);
+    SDL_free(data);
+
+    face->data_ = face->owned_.data();
+    face->size_ = face->owned_.size();
+#endif
+
+    return face;
+}
+
+std::shared_ptr<const FontFace> FontFace::copyBuffer(const void *buffer, size_t size) {
+    assert(buffer);
+
+    std::shared_ptr<FontFace> face(new FontFace());
+    const unsigned char *bytes = static_cast<const unsigned char *>(buffer);
+    face->owned_.assign(bytes, bytes + size);
+    face->data_ = face->owned_.data();
+    face->size_ = face->owned_.size();
+    return face;
+}
+
+const unsigned char *FontFace::data() const { return data_; }
+size_t FontFace::size() const { return size_; }
+uint64_t FontFace::getId() const { return id_; }
+
+bool FontFace::equals(const void *buffer, size_t size) const {
+    return size == size_ && std::memcmp(buffer, data_, size) == 0;
+}
+
+// ---------------- FontFaceRegistry ----------------
+std::shared_ptr<const FontFace> FontFaceRegistry::acquireFile(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+        if (auto face = it->second.lock()) return face;
+    }
+
+    pruneExpired();
+
+    std::shared_ptr<const FontFace> face = FontFace::mapFile(path);
+    files_[path] = face;
+    return face;
+}
+
+std::shared_ptr<const FontFace> FontFaceRegistry::acquireBuffer(const void *buffer, size_t size) {
+    assert(buffer);
+    const uint64_t hash = hashBuffer(buffer, size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto [first, last] = buffers_.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        auto face = it->second.lock();
+        if (face && face->equals(buffer, size)) return face;
+    }
+
+    pruneExpired();
+
+    std::shared_ptr<const FontFace> face = FontFace::copyBuffer(buffer, size);
+    buffers_.emplace(hash, face);
+    return face;
+}
+
+size_t FontFaceRegistry::getLiveFaceCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t count = 0;
+    for (const auto &[path, face] : files_) count += !face.expired();
+    for (const auto &[hash, face] : buffers_) count += !face.expired();
+    return count;
+}
+
+uint64_t FontFaceRegistry::hashBuffer(const void *buffer, size_t size) {
+    // FNV-1a
+    const unsigned char *bytes = static_cast<const unsigned char *>(buffer);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void FontFaceRegistry::pruneExpired() {
+    std::erase_if(files_, [](const auto &entry) { return entry.second.expired(); });
+    std::erase_if(buffers_, [](const auto &entry) { return entry.second.expired(); });
+}
+
+}
@@ -0,0 +1,54 @@
+#include "GeometryBatch.hpp"
+#include "Window.hpp"
+
+namespace ia {
+
+// ---------------- GeometryBatch ----------------
+GeometryBatch::GeometryBatch(RenderState &renderState) : renderState_(renderState) {}
+
+Mesh &GeometryBatch::begin(const Texture &target, const SDL_Rect &clip) {
+    bool sameClip = clip.x == clip_.x && clip.y == clip_.y && clip.w == clip_.w && clip.h == clip_.h;
+    if (target_ != &target || !sameClip) {
+        flush();
+        target_ = &target;
+        clip_ = clip;
+    }
+
+    ++stats_.primitives;
+    return mesh_;
+}
+
+void GeometryBatch::commit() {
+    assert(target_);
+    if (!target_->isBatching()) flush();
+}
+
+void GeometryBatch::flush() {
+    const Texture *target = target_;
+    target_ = nullptr;
+    if (!target || mesh_.empty()) {
+        mesh_.clear();
+        return;
+    }
+
+    renderState_.setTarget(target->getTexture());
+    renderState_.setClipRect(&clip_);
+    renderState_.setBlendMode(SDL_BLENDMODE_BLEND);
+
+    int drawn = SDL_RenderGeometry(renderState_.getRenderer().get(), nullptr,
+                                   mesh_.vertices.data(), static_cast<int>(mesh_.vertices.size()),
+                                   mesh_.indices.data(), static_cast<int>(mesh_.indices.size()));
+    mesh_.clear();
+    ++stats_.flushes;
+    requireSDLCondition(drawn == 0);
+}
+
+void GeometryBatch::discard(const Texture *target) {
+    if (target_ != target) return;
+    target_ = nullptr;
+    mesh_.clear();
+}
+
+const GeometryBatch::Stats &GeometryBatch::getStats() const { return stats_; }
+
+}
@@ -0,0 +1,111 @@
+#include "GlyphAtlas.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ia {
+
+// ---------------- GlyphAtlas ----------------
+const GlyphAtlas::Glyph &GlyphAtlas::getGlyph(const raii::SDL_Renderer &renderer, ::TTF_Font *font, Uint32 codepoint) {
+    auto it = glyphs_.find(codepoint);
+    if (it != glyphs_.end()) return it->second;
+
+    return glyphs_.emplace(codepoint, rasterize(renderer, font, codepoint)).first->second;
+}
+
+::SDL_Texture *GlyphAtlas::getPage(int page) const {
+    assert(page >= 0 && static_cast<size_t>(page) < pages_.size());
+    return pages_[page].get();
+}
+
+size_t GlyphAtlas::getPageCount() const { return pages_.size(); }
+
+GlyphAtlas::Glyph GlyphAtlas::rasterize(const raii::SDL_Renderer &renderer, ::TTF_Font *font, Uint32 codepoint) {
+    assert(font);
+
+    int minX = 0, advance = 0;
+    if (TTF_GlyphMetrics32(font, codepoint, &minX, nullptr, nullptr, nullptr, &advance) != 0) {
+        return Glyph{0, SDL_Rect{0, 0, 0, 0}, 0, 0};
+    }
+
+    raii::SDL_Surface surf(TTF_RenderGlyph32_Blended(font, codepoint, SDL_Color{255, 255, 255, 255}));
+    if (!surf || surf->w == 0 || surf->h == 0) {
+        return Glyph{0, SDL_Rect{0, 0, 0, 0}, 0, advance};
+    }
+
+    if (surf->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        surf.reset(SDL_ConvertSurfaceFormat(surf.get(), SDL_PIXELFORMAT_ARGB8888, 0));
+        requireSDLCondition(surf != nullptr);
+    }
+
+    SDL_Rect rect = allocate(renderer, surf->w, surf->h);
+
+    requireSDLCondition(SDL_LockSurface(surf.get()) == 0);
+    int updated = SDL_UpdateTexture(pages_.back().get(), &rect, surf->pixels, surf->pitch);
+    SDL_UnlockSurface(surf.get());
+    requireSDLCondition(updated == 0);
+
+    return Glyph{static_cast<int>(pages_.size()) - 1, rect, std::min(0, minX), advance};
+}
+
+SDL_Rect GlyphAtlas::allocate(const raii::SDL_Renderer &renderer, int width, int height) {
+    if (width + 2 * GLYPH_PADDING > PAGE_SIZE || height + 2 * GLYPH_PADDING > PAGE_SIZE) {
+        throw_invalid_argument("glyph does not fit into an atlas page");
+    }
+
+    if (pages_.empty()) addPage(renderer);
+
+    if (cursorX_ + width + GLYPH_PADDING > PAGE_SIZE) {
+        cursorX_ = GLYPH_PADDING;
+        cursorY_ += shelfHeight_ + GLYPH_PADDING;
+        shelfHeight_ = 0;
+    }
+
+    if (cursorY_ + height + GLYPH_PADDING > PAGE_SIZE) addPage(renderer);
+
+    SDL_Rect rect{cursorX_, cursorY_, width, height};
+    cursorX_ += width + GLYPH_PADDING;
+    shelfHeight_ = std::max(shelfHeight_, height);
+    return rect;
+}
+
+void GlyphAtlas::addPage(const raii::SDL_Renderer &renderer) {
+    raii::SDL_Texture page = raii::SDL_CreateTexture(renderer,
+                                                     SDL_PIXELFORMAT_ARGB8888,
+                                                     SDL_TEXTUREACCESS_STATIC,
+                                                     PAGE_SIZE, PAGE_SIZE);
+    requireSDLCondition(page != nullptr);
+    requireSDLCondition(SDL_SetTextureBlendMode(page.get(), SDL_BLENDMODE_BLEND) == 0);
+
+    std::vector<Uint32> blank(static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE, 0);
+    requireSDLCondition(SDL_UpdateTexture(page.get(), nullptr, blank.data(), PAGE_SIZE * sizeof(Uint32)) == 0);
+
+    pages_.push_back(std::move(page));
+    cursorX_ = GLYPH_PADDING;
+    cursorY_ = GLYPH_PADDING;
+    shelfHeight_ = 0;
+}
+
+// ---------------- GlyphAtlasCache ----------------
+GlyphAtlas &GlyphAtlasCache::get(uint64_t faceId, int fontSize) {
+    Key key{faceId, fontSize};
+
+    auto it = std::find_if(lru_.begin(), lru_.end(), [&key](const Node &node) { return node.first == key; });
+    if (it != lru_.end()) {
+        lru_.splice(lru_.begin(), lru_, it);
+        return *lru_.front().second;
+    }
+
+    lru_.emplace_front(key, std::make_unique<GlyphAtlas>());
+    if (lru_.size() > MAX_ATLASES) lru_.pop_back();
+
+    return *lru_.front().second;
+}
+
+void GlyphAtlasCache::invalidateFace(uint64_t faceId) {
+    lru_.remove_if([faceId](const Node &node) { return node.first.first == faceId; });
+}
+
+void GlyphAtlasCache::clear() { lru_.clear(); }
+
+}
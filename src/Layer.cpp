@@ -0,0 +1,81 @@
+#include "Layer.hpp"
+
+#include <algorithm>
+
+namespace ia {
+
+// ---------------- Layer ----------------
+Layer::Layer(const Window &window, int width, int height) : texture_(window, width, height) {}
+
+void Layer::DrawOn(dr4::Texture &texture) const {
+    if (isStale()) {
+        ++stats_.misses;
+        render();
+    } else {
+        ++stats_.hits;
+    }
+    texture_.DrawOn(texture);
+}
+
+void Layer::SetPos(dr4::Vec2f pos) { texture_.SetPos(pos); }
+dr4::Vec2f Layer::GetPos() const { return texture_.GetPos(); }
+
+void Layer::add(const Line &line) { addSource(line); }
+void Layer::add(const Polyline &polyline) { addSource(polyline); }
+void Layer::add(const Circle &circle) { addSource(circle); }
+void Layer::add(const Rectangle &rectangle) { addSource(rectangle); }
+void Layer::add(const Text &text) { addSource(text); }
+void Layer::add(const Image &image) { addSource(image); }
+
+void Layer::remove(const dr4::Drawable &drawable) {
+    const size_t removed = std::erase_if(sources_, [&](const Source &source) { return source.drawable == &drawable; });
+    if (removed) invalidated_ = true;
+}
+
+void Layer::clear() {
+    sources_.clear();
+    invalidated_ = true;
+}
+
+size_t Layer::size() const { return sources_.size(); }
+
+void Layer::setSize(dr4::Vec2f size) {
+    texture_.SetSize(size);
+    invalidated_ = true;
+}
+
+dr4::Vec2f Layer::getSize() const { return texture_.GetSize(); }
+
+void Layer::setClearColor(dr4::Color color) {
+    clearColor_ = color;
+    invalidated_ = true;
+}
+
+void Layer::invalidate() { invalidated_ = true; }
+
+bool Layer::isStale() const {
+    if (invalidated_) return true;
+    return std::any_of(sources_.begin(), sources_.end(), [](const Source &source) {
+        return source.generation(*source.drawable) != source.rendered;
+    });
+}
+
+void Layer::update() const {
+    if (isStale()) render();
+}
+
+const Texture &Layer::getTexture() const { return texture_; }
+Layer::Stats Layer::getStats() const { return stats_; }
+void Layer::resetStats() { stats_ = Stats{}; }
+
+void Layer::render() const {
+    texture_.Clear(clearColor_);
+    for (Source &source : sources_) {
+        source.rendered = source.generation(*source.drawable);
+        source.drawable->DrawOn(texture_);
+    }
+    invalidated_ = false;
+    ++stats_.renders;
+}
+
+}
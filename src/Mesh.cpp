@@ -0,0 +1,290 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace ia {
+
+// ---------------- Mesh ----------------
+void Mesh::clear() {
+    vertices.clear();
+    indices.clear();
+}
+
+bool Mesh::empty() const { return indices.empty(); }
+
+SDL_FRect Mesh::getBounds() const {
+    if (vertices.empty()) return SDL_FRect{0, 0, 0, 0};
+
+    SDL_FPoint min = vertices.front().position, max = min;
+    for (const SDL_Vertex &vertex : vertices) {
+        min.x = std::min(min.x, vertex.position.x);
+        min.y = std::min(min.y, vertex.position.y);
+        max.x = std::max(max.x, vertex.position.x);
+        max.y = std::max(max.y, vertex.position.y);
+    }
+    return SDL_FRect{min.x, min.y, max.x - min.x, max.y - min.y};
+}
+
+int Mesh::addVertex(SDL_FPoint position, SDL_Color color) {
+    vertices.push_back(SDL_Vertex{position, color, SDL_FPoint{0, 0}});
+    return static_cast<int>(vertices.size()) - 1;
+}
+
+void Mesh::appendQuad(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_FPoint d, SDL_Color color) {
+    int base = addVertex(a, color);
+    addVertex(b, color);
+    addVertex(c, color);
+    addVertex(d, color);
+    for (int offset : {0, 1, 2, 0, 2, 3}) indices.push_back(base + offset);
+}
+
+void Mesh::appendRect(SDL_FRect rect, SDL_Color color) {
+    if (rect.w <= 0 || rect.h <= 0) return;
+    appendQuad(SDL_FPoint{rect.x,          rect.y},
+               SDL_FPoint{rect.x + rect.w, rect.y},
+               SDL_FPoint{rect.x + rect.w, rect.y + rect.h},
+               SDL_FPoint{rect.x,          rect.y + rect.h},
+               color);
+}
+
+void Mesh::appendLine(SDL_FPoint from, SDL_FPoint to, float thickness, SDL_Color color) {
+    float dx = to.x - from.x;
+    float dy = to.y - from.y;
+    float length = std::hypot(dx, dy);
+    if (length == 0) return;
+
+    float halfWidth = std::max(thickness, 1.0f) / 2;
+    float nx = -dy / length * halfWidth;
+    float ny =  dx / length * halfWidth;
+
+    appendQuad(SDL_FPoint{from.x + nx, from.y + ny},
+               SDL_FPoint{to.x + nx,   to.y + ny},
+               SDL_FPoint{to.x - nx,   to.y - ny},
+               SDL_FPoint{from.x - nx, from.y - ny},
+               color);
+}
+
+namespace {
+
+SDL_FPoint operator+(SDL_FPoint a, SDL_FPoint b) { return SDL_FPoint{a.x + b.x, a.y + b.y}; }
+SDL_FPoint operator-(SDL_FPoint a, SDL_FPoint b) { return SDL_FPoint{a.x - b.x, a.y - b.y}; }
+SDL_FPoint operator*(SDL_FPoint a, float k)      { return SDL_FPoint{a.x * k, a.y * k}; }
+float dot(SDL_FPoint a, SDL_FPoint b)            { return a.x * b.x + a.y * b.y; }
+float cross(SDL_FPoint a, SDL_FPoint b)          { return a.x * b.y - a.y * b.x; }
+float length(SDL_FPoint a)                       { return std::hypot(a.x, a.y); }
+
+constexpr float EPSILON = 1e-4f;
+
+}
+
+void Mesh::appendPolyline(std::span<const SDL_FPoint> input, float thickness, SDL_Color color,
+                          LineJoin join, bool closed, float miterLimit) {
+    std::vector<SDL_FPoint> points;
+    points.reserve(input.size());
+    for (const SDL_FPoint &point : input) {
+        if (points.empty() || length(point - points.back()) > EPSILON) points.push_back(point);
+    }
+    if (closed && points.size() > 1 && length(points.front() - points.back()) <= EPSILON) points.pop_back();
+
+    const size_t count = points.size();
+    if (count < 2) return;
+    if (count < 3) closed = false;
+
+    const float halfWidth = std::max(thickness, 1.0f) / 2;
+    const size_t segmentCount = closed ? count : count - 1;
+
+    std::vector<SDL_FPoint> directions(segmentCount), normals(segmentCount);
+    std::vector<float> lengths(segmentCount);
+    for (size_t seg = 0; seg < segmentCount; ++seg) {
+        SDL_FPoint delta = points[(seg + 1) % count] - points[seg];
+        lengths[seg] = length(delta);
+        directions[seg] = delta * (1 / lengths[seg]);
+        normals[seg] = SDL_FPoint{-directions[seg].y, directions[seg].x};
+    }
+
+    // Vertices where the incoming segment ends and the outgoing one starts; equal for miters.
+    struct Joint { int inLeft, inRight, outLeft, outRight; };
+    std::vector<Joint> joints(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const SDL_FPoint p = points[i];
+        const bool hasIn = closed || i > 0;
+        const bool hasOut = closed || i + 1 < count;
+
+        if (!hasIn || !hasOut) {
+            SDL_FPoint normal = hasOut ? normals[i] : normals[i - 1];
+            int left = addVertex(p + normal * halfWidth, color);
+            int right = addVertex(p - normal * halfWidth, color);
+            joints[i] = Joint{left, right, left, right};
+            continue;
+        }
+
+        const size_t segIn = (i + segmentCount - 1) % segmentCount;
+        const size_t segOut = i % segmentCount;
+        const SDL_FPoint n0 = normals[segIn], n1 = normals[segOut];
+        const float turn = cross(directions[segIn], directions[segOut]);
+
+        SDL_FPoint miter = n0 + n1;
+        float miterNorm = length(miter);
+        if (miterNorm < EPSILON) {
+            // The path doubles back on itself: no sensible join, just butt both segments.
+            joints[i] = Joint{addVertex(p + n0 * halfWidth, color), addVertex(p - n0 * halfWidth, color),
+                              addVertex(p + n1 * halfWidth, color), addVertex(p - n1 * halfWidth, color)};
+            continue;
+        }
+        miter = miter * (1 / miterNorm);
+        const float miterLength = halfWidth / dot(miter, n0);
+
+        if (std::fabs(turn) < EPSILON || (join == LineJoin::MITER && miterLength <= halfWidth * miterLimit)) {
+            int left = addVertex(p + miter * miterLength, color);
+            int right = addVertex(p - miter * miterLength, color);
+            joints[i] = Joint{left, right, left, right};
+            continue;
+        }
+
+        // The path turns towards +normal when turn > 0, so the outer side is -normal.
+        const float outerSign = turn > 0 ? -1.0f : 1.0f;
+        const float maxInner = std::hypot(halfWidth, std::min(lengths[segIn], lengths[segOut]));
+        const float innerLength = std::min(miterLength, maxInner);
+
+        int inner = addVertex(p - miter * (outerSign * innerLength), color);
+        SDL_FPoint outerIn = p + n0 * (outerSign * halfWidth);
+        SDL_FPoint outerOut = p + n1 * (outerSign * halfWidth);
+        int a = addVertex(outerIn, color);
+
+        if (join == LineJoin::ROUND) {
+            float from = std::atan2(outerIn.y - p.y, outerIn.x - p.x);
+            float sweep = std::atan2(outerOut.y - p.y, outerOut.x - p.x) - from;
+            if (sweep >  std::numbers::pi_v<float>) sweep -= 2 * std::numbers::pi_v<float>;
+            if (sweep < -std::numbers::pi_v<float>) sweep += 2 * std::numbers::pi_v<float>;
+
+            const float step = 2 * std::numbers::pi_v<float> / ellipseSegments(SDL_FPoint{halfWidth, halfWidth});
+            const int steps = std::max(1, static_cast<int>(std::ceil(std::fabs(sweep) / step)));
+
+            int prev = a;
+            for (int k = 1; k < steps; ++k) {
+                float angle = from + sweep * k / steps;
+                int cur = addVertex(SDL_FPoint{p.x + halfWidth * std::cos(angle), p.y + halfWidth * std::sin(angle)}, color);
+                for (int index : {inner, prev, cur}) indices.push_back(index);
+                prev = cur;
+            }
+
+            int b = addVertex(outerOut, color);
+            for (int index : {inner, prev, b}) indices.push_back(index);
+            joints[i] = turn > 0 ? Joint{inner, a, inner, b} : Joint{a, inner, b, inner};
+        } else {
+            int b = addVertex(outerOut, color);
+            for (int index : {inner, a, b}) indices.push_back(index);
+            joints[i] = turn > 0 ? Joint{inner, a, inner, b} : Joint{a, inner, b, inner};
+        }
+    }
+
+    for (size_t seg = 0; seg < segmentCount; ++seg) {
+        const Joint &from = joints[seg];
+        const Joint &to = joints[(seg + 1) % count];
+        for (int index : {from.outLeft, to.inLeft, to.inRight, from.outLeft, to.inRight, from.outRight})
+            indices.push_back(index);
+    }
+}
+
+void Mesh::appendMesh(const Mesh &other, SDL_FPoint offset) {
+    const int base = static_cast<int>(vertices.size());
+
+    vertices.reserve(vertices.size() + other.vertices.size());
+    for (SDL_Vertex vertex : other.vertices) {
+        vertex.position.x += offset.x;
+        vertex.position.y += offset.y;
+        vertices.push_back(vertex);
+    }
+
+    indices.reserve(indices.size() + other.indices.size());
+    for (int index : other.indices) indices.push_back(base + index);
+}
+
+void Mesh::appendEllipse(SDL_FPoint center, SDL_FPoint radius, SDL_Color color, int segments) {
+    if (radius.x <= 0 || radius.y <= 0) return;
+
+    const std::vector<SDL_FPoint> &ring = unitCircle(segments > 0 ? segments : ellipseSegments(radius));
+    const int count = static_cast<int>(ring.size());
+
+    int centerIndex = addVertex(center, color);
+    for (const SDL_FPoint &unit : ring) {
+        addVertex(SDL_FPoint{center.x + radius.x * unit.x, center.y + radius.y * unit.y}, color);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        indices.push_back(centerIndex);
+        indices.push_back(centerIndex + 1 + i);
+        indices.push_back(centerIndex + 1 + (i + 1) % count);
+    }
+}
+
+void Mesh::appendEllipseRing(SDL_FPoint center, SDL_FPoint outerRadius, SDL_FPoint innerRadius,
+                             SDL_Color color, int segments) {
+    appendRingStrip(center, outerRadius, color, innerRadius, color,
+                    segments > 0 ? segments : ellipseSegments(outerRadius));
+}
+
+void Mesh::appendEllipseFringe(SDL_FPoint center, SDL_FPoint radius, float width,
+                               SDL_Color color, int segments) {
+    SDL_FPoint outerRadius{radius.x + width, radius.y + width};
+    SDL_Color transparent{color.r, color.g, color.b, 0};
+    appendRingStrip(center, outerRadius, transparent, radius, color,
+                    segments > 0 ? segments : ellipseSegments(outerRadius));
+}
+
+void Mesh::appendRingStrip(SDL_FPoint center, SDL_FPoint outerRadius, SDL_Color outerColor,
+                           SDL_FPoint innerRadius, SDL_Color innerColor, int segments) {
+    if (outerRadius.x <= 0 || outerRadius.y <= 0) return;
+
+    const std::vector<SDL_FPoint> &ring = unitCircle(segments);
+    const int count = static_cast<int>(ring.size());
+
+    int base = static_cast<int>(vertices.size());
+    for (const SDL_FPoint &unit : ring) {
+        addVertex(SDL_FPoint{center.x + outerRadius.x * unit.x, center.y + outerRadius.y * unit.y}, outerColor);
+        addVertex(SDL_FPoint{center.x + std::max(innerRadius.x, 0.0f) * unit.x,
+                             center.y + std::max(innerRadius.y, 0.0f) * unit.y}, innerColor);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int outer = base + 2 * i, inner = outer + 1;
+        int nextOuter = base + 2 * ((i + 1) % count), nextInner = nextOuter + 1;
+        for (int index : {outer, nextOuter, nextInner, outer, nextInner, inner}) indices.push_back(index);
+    }
+}
+
+int Mesh::ellipseSegments(SDL_FPoint radius) {
+    // Keeps the chord error below roughly a quarter of a pixel for the on-screen radius.
+    float r = std::max(radius.x, radius.y);
+    int wanted = static_cast<int>(std::ceil(std::numbers::pi_v<float> / std::acos(std::max(0.0f, 1 - 0.25f / std::max(r, 1.0f)))));
+
+    for (int bucket : SEGMENT_BUCKETS) {
+        if (bucket >= wanted) return bucket;
+    }
+    return SEGMENT_BUCKETS.back();
+}
+
+const std::vector<SDL_FPoint> &Mesh::unitCircle(int segments) {
+    static const auto rings = [] {
+        std::array<std::vector<SDL_FPoint>, SEGMENT_BUCKETS.size()> result;
+        for (size_t bucket = 0; bucket < SEGMENT_BUCKETS.size(); ++bucket) {
+            const int count = SEGMENT_BUCKETS[bucket];
+            const float step = 2 * std::numbers::pi_v<float> / count;
+            result[bucket].reserve(count);
+            for (int i = 0; i < count; ++i) {
+                result[bucket].push_back(SDL_FPoint{std::cos(i * step), std::sin(i * step)});
+            }
+        }
+        return result;
+    }();
+
+    for (size_t bucket = 0; bucket < SEGMENT_BUCKETS.size(); ++bucket) {
+        if (SEGMENT_BUCKETS[bucket] >= segments) return rings[bucket];
+    }
+    return rings.back();
+}
+
+}
@@ -0,0 +1,345 @@
+#include "PixelConvert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "IAError.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IA_PIXEL_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define IA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define IA_TARGET_AVX2
+#endif
+#endif
+
+namespace ia {
+
+namespace {
+
+static_assert(sizeof(dr4::Color) == 4);
+
+// out byte i = in byte from[i], within every 4-byte pixel.
+struct Shuffle {
+    std::array<int, 4> from;
+};
+
+using ShuffleKernel = void (*)(const Uint32 *src, Uint32 *dst, size_t count, const Shuffle &shuffle);
+using AlphaKernel = void (*)(Uint32 *pixels, size_t count);
+
+struct Kernels {
+    ShuffleKernel shuffle;
+    AlphaKernel premultiply;
+    AlphaKernel unpremultiply;
+};
+
+// ---------------- Scalar ----------------
+inline Uint8 div255(unsigned value) {
+    value += 128;
+    return static_cast<Uint8>((value + (value >> 8)) >> 8);
+}
+
+void shuffleScalar(const Uint32 *src, Uint32 *dst, size_t count, const Shuffle &shuffle) {
+    for (size_t i = 0; i < count; ++i) {
+        Uint8 in[4], out[4];
+        std::memcpy(in, src + i, 4);
+        for (int byte = 0; byte < 4; ++byte) out[byte] = in[shuffle.from[byte]];
+        std::memcpy(dst + i, out, 4);
+    }
+}
+
+void premultiplyScalar(Uint32 *pixels, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        Uint8 p[4];
+        std::memcpy(p, pixels + i, 4);
+        for (int c = 0; c < 3; ++c) p[c] = div255(p[c] * p[3]);
+        std::memcpy(pixels + i, p, 4);
+    }
+}
+
+void unpremultiplyScalar(Uint32 *pixels, size_t count) {
+    // 255 / a in float and rounded to nearest even, exactly what the SIMD kernels compute,
+    // so results don't depend on the CPU or on whether a pixel lands in a vector tail.
+    // a == 0 is treated as 1.
+    static const std::array<float, 256> scales = [] {
+        std::array<float, 256> table{};
+        for (unsigned a = 0; a < 256; ++a) table[a] = 255.0f / static_cast<float>(std::max(a, 1u));
+        return table;
+    }();
+
+    for (size_t i = 0; i < count; ++i) {
+        Uint8 p[4];
+        std::memcpy(p, pixels + i, 4);
+        if (p[3] == 255) continue;
+        for (int c = 0; c < 3; ++c) {
+            const float value = std::nearbyint(static_cast<float>(p[c]) * scales[p[3]]);
+            p[c] = static_cast<Uint8>(value > 255.0f ? 255.0f : value);
+        }
+        std::memcpy(pixels + i, p, 4);
+    }
+}
+
+constexpr Kernels SCALAR_KERNELS = {shuffleScalar, premultiplyScalar, unpremultiplyScalar};
+
+#if defined(IA_PIXEL_X86)
+// ---------------- SSE2 ----------------
+// No byte shuffle before SSSE3: every output byte is shifted into place separately.
+void shuffleSSE2(const Uint32 *src, Uint32 *dst, size_t count, const Shuffle &shuffle) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    __m128i right[4], left[4];
+    for (int byte = 0; byte < 4; ++byte) {
+        right[byte] = _mm_cvtsi32_si128(8 * shuffle.from[byte]);
+        left[byte] = _mm_cvtsi32_si128(8 * byte);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i out = _mm_setzero_si128();
+        for (int byte = 0; byte < 4; ++byte) {
+            const __m128i channel = _mm_and_si128(_mm_srl_epi32(in, right[byte]), byteMask);
+            out = _mm_or_si128(out, _mm_sll_epi32(channel, left[byte]));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), out);
+    }
+    shuffleScalar(src + i, dst + i, count - i, shuffle);
+}
+
+// Two pixels widened to 16 bits per channel, scaled by alpha (alpha itself by 255).
+inline __m128i premultiplyWordsSSE2(__m128i words) {
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    __m128i alpha = _mm_shufflelo_epi16(words, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha), _mm_and_si128(alphaLanes, _mm_set1_epi16(255)));
+
+    __m128i product = _mm_add_epi16(_mm_mullo_epi16(words, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+
+void premultiplySSE2(Uint32 *pixels, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128i low = premultiplyWordsSSE2(_mm_unpacklo_epi8(in, zero));
+        const __m128i high = premultiplyWordsSSE2(_mm_unpackhi_epi8(in, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), _mm_packus_epi16(low, high));
+    }
+    premultiplyScalar(pixels + i, count - i);
+}
+
+// One pixel as four floats, channels scaled by 255 / alpha.
+inline __m128i unpremultiplyPixelSSE2(__m128i dwords) {
+    const __m128 channels = _mm_cvtepi32_ps(dwords);
+    const __m128 alpha = _mm_max_ps(_mm_shuffle_ps(channels, channels, _MM_SHUFFLE(3, 3, 3, 3)), _mm_set1_ps(1.0f));
+    __m128 scale = _mm_div_ps(_mm_set1_ps(255.0f), alpha);
+    scale = _mm_or_ps(_mm_and_ps(scale, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))),
+                      _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+    return _mm_cvtps_epi32(_mm_mul_ps(channels, scale));
+}
+
+void unpremultiplySSE2(Uint32 *pixels, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128i low = _mm_unpacklo_epi8(in, zero);
+        const __m128i high = _mm_unpackhi_epi8(in, zero);
+
+        const __m128i p0 = unpremultiplyPixelSSE2(_mm_unpacklo_epi16(low, zero));
+        const __m128i p1 = unpremultiplyPixelSSE2(_mm_unpackhi_epi16(low, zero));
+        const __m128i p2 = unpremultiplyPixelSSE2(_mm_unpacklo_epi16(high, zero));
+        const __m128i p3 = unpremultiplyPixelSSE2(_mm_unpackhi_epi16(high, zero));
+
+        const __m128i out = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), out);
+    }
+    unpremultiplyScalar(pixels + i, count - i);
+}
+
+constexpr Kernels SSE2_KERNELS = {shuffleSSE2, premultiplySSE2, unpremultiplySSE2};
+
+// ---------------- AVX2 ----------------
+IA_TARGET_AVX2 void shuffleAVX2(const Uint32 *src, Uint32 *dst, size_t count, const Shuffle &shuffle) {
+    // vpshufb works within 128-bit lanes, which never splits a pixel.
+    alignas(32) Uint8 pattern[32];
+    for (int byte = 0; byte < 32; ++byte) {
+        pattern[byte] = static_cast<Uint8>((byte & 12) + shuffle.from[byte & 3]);
+    }
+    const __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i *>(pattern));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_shuffle_epi8(in, mask));
+    }
+    shuffleSSE2(src + i, dst + i, count - i, shuffle);
+}
+
+// Same as premultiplyWordsSSE2, on four pixels.
+IA_TARGET_AVX2 inline __m256i premultiplyWordsAVX2(__m256i words) {
+    const __m256i alphaWords = _mm256_set_epi64x(0x0F0E0F0E0F0E0F0ELL, 0x0706070607060706LL,
+                                                 0x0F0E0F0E0F0E0F0ELL, 0x0706070607060706LL);
+    const __m256i alpha = _mm256_blend_epi16(_mm256_shuffle_epi8(words, alphaWords), _mm256_set1_epi16(255), 0x88);
+
+    const __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(words, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+}
+
+IA_TARGET_AVX2 void premultiplyAVX2(Uint32 *pixels, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        const __m256i low = premultiplyWordsAVX2(_mm256_unpacklo_epi8(in, zero));
+        const __m256i high = premultiplyWordsAVX2(_mm256_unpackhi_epi8(in, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i), _mm256_packus_epi16(low, high));
+    }
+    premultiplySSE2(pixels + i, count - i);
+}
+
+IA_TARGET_AVX2 void unpremultiplyAVX2(Uint32 *pixels, size_t count) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 full = _mm256_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        // Two pixels, one per 128-bit lane.
+        const __m128i in = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m256 channels = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(in));
+        const __m256 alpha = _mm256_max_ps(_mm256_shuffle_ps(channels, channels, _MM_SHUFFLE(3, 3, 3, 3)), one);
+        const __m256 scale = _mm256_blend_ps(_mm256_div_ps(full, alpha), one, 0x88);
+
+        const __m256i out = _mm256_cvtps_epi32(_mm256_mul_ps(channels, scale));
+        const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(pixels + i), _mm_packus_epi16(words, words));
+    }
+    unpremultiplyScalar(pixels + i, count - i);
+}
+
+constexpr Kernels AVX2_KERNELS = {shuffleAVX2, premultiplyAVX2, unpremultiplyAVX2};
+#endif
+
+// ---------------- Dispatch ----------------
+PixelIsa detectIsa() {
+#if defined(IA_PIXEL_X86)
+    if (SDL_HasAVX2()) return PixelIsa::AVX2;
+    if (SDL_HasSSE2()) return PixelIsa::SSE2;
+#endif
+    return PixelIsa::SCALAR;
+}
+
+const PixelIsa SUPPORTED_ISA = detectIsa();
+std::atomic<PixelIsa> activeIsa{SUPPORTED_ISA};
+
+const Kernels &kernels() {
+    switch (activeIsa.load(std::memory_order_relaxed)) {
+#if defined(IA_PIXEL_X86)
+        case PixelIsa::AVX2: return AVX2_KERNELS;
+        case PixelIsa::SSE2: return SSE2_KERNELS;
+#endif
+        default:             return SCALAR_KERNELS;
+    }
+}
+
+// ---------------- Formats ----------------
+enum Channel { R, G, B, A };
+
+struct ByteOrder {
+    Uint32 format;
+    std::array<int, 4> channels;   // channel stored at each byte in memory
+};
+
+constexpr std::array<ByteOrder, 4> BYTE_ORDERS = {{
+    {SDL_PIXELFORMAT_RGBA32, {R, G, B, A}},
+    {SDL_PIXELFORMAT_BGRA32, {B, G, R, A}},
+    {SDL_PIXELFORMAT_ARGB32, {A, R, G, B}},
+    {SDL_PIXELFORMAT_ABGR32, {A, B, G, R}},
+}};
+
+const ByteOrder *findByteOrder(Uint32 format) {
+    for (const ByteOrder &order : BYTE_ORDERS) {
+        if (order.format == format) return &order;
+    }
+    return nullptr;
+}
+
+Shuffle makeShuffle(const ByteOrder &src, const ByteOrder &dst) {
+    Shuffle shuffle{};
+    for (int byte = 0; byte < 4; ++byte) {
+        for (int from = 0; from < 4; ++from) {
+            if (src.channels[from] == dst.channels[byte]) shuffle.from[byte] = from;
+        }
+    }
+    return shuffle;
+}
+
+}
+
+PixelIsa getPixelIsa() { return activeIsa.load(std::memory_order_relaxed); }
+
+void setPixelIsa(PixelIsa isa) {
+    activeIsa.store(isa > SUPPORTED_ISA ? SUPPORTED_ISA : isa, std::memory_order_relaxed);
+}
+
+bool hasFastConversion(Uint32 srcFormat, Uint32 dstFormat) {
+    return findByteOrder(srcFormat) && findByteOrder(dstFormat);
+}
+
+void convertPixels(const void *src, int srcPitch, Uint32 srcFormat,
+                   void *dst, int dstPitch, Uint32 dstFormat, int width, int height) {
+    const ByteOrder *srcOrder = findByteOrder(srcFormat);
+    const ByteOrder *dstOrder = findByteOrder(dstFormat);
+    if (!srcOrder || !dstOrder) {
+        requireSDLCondition(SDL_ConvertPixels(width, height, srcFormat, src, srcPitch,
+                                              dstFormat, dst, dstPitch) == 0);
+        return;
+    }
+
+    const Uint8 *srcRow = static_cast<const Uint8 *>(src);
+    Uint8 *dstRow = static_cast<Uint8 *>(dst);
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+
+    if (srcOrder == dstOrder) {
+        if (srcRow == dstRow && srcPitch == dstPitch) return;
+        for (int y = 0; y < height; ++y, srcRow += srcPitch, dstRow += dstPitch) {
+            std::memmove(dstRow, srcRow, rowBytes);
+        }
+        return;
+    }
+
+    const Shuffle shuffle = makeShuffle(*srcOrder, *dstOrder);
+    const ShuffleKernel kernel = kernels().shuffle;
+    for (int y = 0; y < height; ++y, srcRow += srcPitch, dstRow += dstPitch) {
+        kernel(reinterpret_cast<const Uint32 *>(srcRow), reinterpret_cast<Uint32 *>(dstRow), width, shuffle);
+    }
+}
+
+Uint32 packColor(dr4::Color color, Uint32 format) {
+    Uint32 packed = 0;
+    packColors(std::span<const dr4::Color>(&color, 1), &packed, format);
+    return packed;
+}
+
+void packColors(std::span<const dr4::Color> colors, Uint32 *dst, Uint32 format) {
+    const int count = static_cast<int>(colors.size());
+    convertPixels(colors.data(), count * 4, CANONICAL_PIXEL_FORMAT, dst, count * 4, format, count, 1);
+}
+
+void premultiplyAlpha(std::span<dr4::Color> pixels) {
+    kernels().premultiply(reinterpret_cast<Uint32 *>(pixels.data()), pixels.size());
+}
+
+void unpremultiplyAlpha(std::span<dr4::Color> pixels) {
+    kernels().unpremultiply(reinterpret_cast<Uint32 *>(pixels.data()), pixels.size());
+}
+
+}
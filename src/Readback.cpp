@@ -0,0 +1,77 @@
+#include "Readback.hpp"
+
+#include <cassert>
+
+#include "Drawable.hpp"
+#include "Window.hpp"
+
+namespace ia {
+
+// ---------------- ReadbackRing ----------------
+ReadbackRing::ReadbackRing(const Window &window) : window_(window) {}
+
+ReadbackRing::~ReadbackRing() {
+    for (Slot &slot : slots_) window_.getRenderState().forgetTarget(slot.staging.get());
+}
+
+ReadbackTicket ReadbackRing::request(::SDL_Texture *source, SDL_Rect rect) {
+    assert(source && rect.w > 0 && rect.h > 0);
+
+    const ReadbackTicket ticket = ++lastTicket_;
+    Slot &slot = slots_[ticket % RING_SIZE];
+    if (slot.ticket != 0 && !slot.collected) ++stats_.dropped;
+
+    RenderState &state = window_.getRenderState();
+    if (!slot.staging || slot.width != rect.w || slot.height != rect.h) {
+        state.forgetTarget(slot.staging.get());
+        slot.staging = raii::SDL_CreateTexture(window_.getRenderer(), window_.getTextureFormat(),
+                                               SDL_TEXTUREACCESS_TARGET, rect.w, rect.h);
+        requireSDLCondition(slot.staging != nullptr);
+        slot.width = rect.w;
+        slot.height = rect.h;
+    }
+
+    window_.getGeometryBatch().flush();
+    state.setTarget(slot.staging.get());
+    state.setClipRect(nullptr);
+
+    // A plain copy: the source must not blend over what the slot held before.
+    SDL_BlendMode blendMode = SDL_BLENDMODE_BLEND;
+    requireSDLCondition(SDL_GetTextureBlendMode(source, &blendMode) == 0);
+    requireSDLCondition(SDL_SetTextureBlendMode(source, SDL_BLENDMODE_NONE) == 0);
+    const int copied = SDL_RenderCopy(window_.getRenderer().get(), source, &rect, nullptr);
+    requireSDLCondition(SDL_SetTextureBlendMode(source, blendMode) == 0);
+    requireSDLCondition(copied == 0);
+
+    slot.ticket = ticket;
+    slot.collected = false;
+    ++stats_.requests;
+    return ticket;
+}
+
+const Image *ReadbackRing::collect(ReadbackTicket ticket) {
+    Slot *slot = findSlot(ticket);
+    if (!slot) return nullptr;
+
+    if (!slot->collected) {
+        if (!slot->image) slot->image = std::make_unique<Image>(slot->width, slot->height);
+
+        window_.getGeometryBatch().flush();
+        window_.getRenderState().setTarget(slot->staging.get());
+        if (!slot->image->readTarget(window_, SDL_Rect{0, 0, slot->width, slot->height})) return nullptr;
+
+        slot->collected = true;
+        ++stats_.collected;
+    }
+    return slot->image.get();
+}
+
+const ReadbackRing::Stats &ReadbackRing::getStats() const { return stats_; }
+
+ReadbackRing::Slot *ReadbackRing::findSlot(ReadbackTicket ticket) {
+    if (ticket == 0) return nullptr;
+    Slot &slot = slots_[ticket % RING_SIZE];
+    return slot.ticket == ticket ? &slot : nullptr;
+}
+
+}
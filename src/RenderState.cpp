@@ -0,0 +1,81 @@
+#include "RenderState.hpp"
+
+namespace ia {
+
+// ---------------- RenderState ----------------
+RenderState::RenderState(const raii::SDL_Renderer &renderer) : renderer_(renderer) {}
+
+void RenderState::setTarget(::SDL_Texture *target) {
+    if (target_ && *target_ == target) {
+        ++stats_.target.skipped;
+        return;
+    }
+
+    requireSDLCondition(SDL_SetRenderTarget(renderer_.get(), target) == 0);
+    target_ = target;
+    ++stats_.target.applied;
+
+    // SDL resets the viewport and clip rect on every target switch.
+    clipRect_.reset();
+}
+
+void RenderState::setDrawColor(SDL_Color color) {
+    if (drawColor_ && drawColor_->r == color.r && drawColor_->g == color.g &&
+                      drawColor_->b == color.b && drawColor_->a == color.a) {
+        ++stats_.drawColor.skipped;
+        return;
+    }
+
+    requireSDLCondition(SDL_SetRenderDrawColor(renderer_.get(), color.r, color.g, color.b, color.a) == 0);
+    drawColor_ = color;
+    ++stats_.drawColor.applied;
+}
+
+void RenderState::setBlendMode(SDL_BlendMode mode) {
+    if (blendMode_ && *blendMode_ == mode) {
+        ++stats_.blendMode.skipped;
+        return;
+    }
+
+    requireSDLCondition(SDL_SetRenderDrawBlendMode(renderer_.get(), mode) == 0);
+    blendMode_ = mode;
+    ++stats_.blendMode.applied;
+}
+
+void RenderState::setClipRect(const SDL_Rect *clip) {
+    if (clipRect_) {
+        const std::optional<SDL_Rect> &current = *clipRect_;
+        bool same = clip == nullptr
+            ? !current.has_value()
+            : current.has_value() && current->x == clip->x && current->y == clip->y &&
+                                     current->w == clip->w && current->h == clip->h;
+        if (same) {
+            ++stats_.clipRect.skipped;
+            return;
+        }
+    }
+
+    requireSDLCondition(SDL_RenderSetClipRect(renderer_.get(), clip) == 0);
+    clipRect_ = clip ? std::optional<SDL_Rect>(*clip) : std::nullopt;
+    ++stats_.clipRect.applied;
+}
+
+void RenderState::forgetTarget(::SDL_Texture *texture) {
+    if (target_ && *target_ == texture) {
+        target_.reset();
+        clipRect_.reset();
+    }
+}
+
+void RenderState::invalidate() {
+    target_.reset();
+    drawColor_.reset();
+    blendMode_.reset();
+    clipRect_.reset();
+}
+
+const raii::SDL_Renderer &RenderState::getRenderer() const { return renderer_; }
+const RenderState::Stats &RenderState::getStats() const { return stats_; }
+void RenderState::resetStats() { stats_ = Stats{}; }
+
+}
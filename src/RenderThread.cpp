@@ -0,0 +1,80 @@
+#include "RenderThread.hpp"
+
+namespace ia {
+
+// ---------------- RenderThread ----------------
+RenderThread::RenderThread() : thread_([this] { run(); }) {}
+
+RenderThread::~RenderThread() {
+    handOver(true);
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void RenderThread::submit() {
+    handOver(false);
+    rethrowError(true);
+}
+
+void RenderThread::finish() {
+    handOver(true);
+    rethrowError(false);
+}
+
+bool RenderThread::isRenderThread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+RenderThread::Stats RenderThread::getStats() const {
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void RenderThread::handOver(bool wait) {
+    std::unique_lock lock(mutex_);
+    changed_.wait(lock, [this] { return pending_ == nullptr; });
+    if (recording_->empty()) return;
+
+    stats_.commands += recording_->size();
+    pending_ = recording_;
+    recording_ = recording_ == &buffers_[0] ? &buffers_[1] : &buffers_[0];
+    changed_.notify_all();
+
+    if (wait) {
+        ++stats_.syncs;
+        changed_.wait(lock, [this] { return pending_ == nullptr; });
+    }
+}
+
+void RenderThread::rethrowError(bool frame) {
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(mutex_);
+        if (frame) ++stats_.frames;
+        error = std::exchange(error_, nullptr);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void RenderThread::run() {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return pending_ != nullptr || stop_; });
+        if (!pending_) return;
+
+        CommandBuffer *buffer = pending_;
+        lock.unlock();
+        std::exception_ptr error = buffer->execute();
+        // Commands may own renderer resources; they are destroyed here as well.
+        buffer->clear();
+        lock.lock();
+
+        if (error && !error_) error_ = error;
+        pending_ = nullptr;
+        changed_.notify_all();
+    }
+}
+
+}
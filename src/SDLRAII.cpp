@@ -1,9 +1,27 @@
 #include "SDLRAII.hpp"
+
+#include <mutex>
+
 #include "Window.hpp"
 
 namespace ia::raii
 {
 
+namespace {
+
+std::mutex &fontLibraryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+}
+
+void TTFFontDeleter::operator()(::TTF_Font *p) const noexcept {
+    if (!p) return;
+    std::lock_guard lock(fontLibraryMutex());
+    TTF_CloseFont(p);
+}
+
 SDL_Window SDL_CreateWindow(const char* title, int x, int y, int w, int h, Uint32 flags) {
     assert(title);
 
@@ -24,23 +42,25 @@ SDL_Texture SDL_CreateTexture(const SDL_Renderer &renderer, Uint32 format, int a
     return SDL_Texture(raw);
 }
 
-SDL_Surface  TTF_RenderUTF8_Blended(const TTF_Font &font, const char* text, SDL_Color color) {
+SDL_Surface  TTF_RenderUTF8_Blended(::TTF_Font *font, const char* text, SDL_Color color) {
     assert(font);
     assert(text);
 
-    ::SDL_Surface* raw = ::TTF_RenderUTF8_Blended(font.get(), text, color);
+    ::SDL_Surface* raw = ::TTF_RenderUTF8_Blended(font, text, color);
 
     return SDL_Surface(raw);
 }
 
 TTF_Font TTF_OpenFont(const char* file, int ptsize) {
     assert(file);
+    std::lock_guard lock(fontLibraryMutex());
     ::TTF_Font* raw = ::TTF_OpenFont(file, ptsize);
     return TTF_Font(raw);
 }
 
 TTF_Font TTF_OpenFontRW(::SDL_RWops* src, int freesrc, int ptsize) {
     assert(src);
+    std::lock_guard lock(fontLibraryMutex());
     ::TTF_Font* raw = ::TTF_OpenFontRW(src, freesrc, ptsize);
     return TTF_Font(raw);
 }
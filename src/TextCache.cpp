@@ -0,0 +1,94 @@
+#include "TextCache.hpp"
+
+#include <functional>
+#include <utility>
+
+namespace ia {
+
+size_t TextCacheKeyHash::operator()(const TextCacheKey &key) const noexcept {
+    size_t seed = std::hash<std::string>{}(key.text);
+    auto combine = [&seed](size_t value) {
+        seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    };
+    combine(std::hash<uint64_t>{}(key.faceId));
+    combine(std::hash<int>{}(key.fontSize));
+    combine(std::hash<Uint32>{}(key.color));
+    return seed;
+}
+
+// ---------------- TextTextureCache ----------------
+TextTextureCache::TextTextureCache(size_t budgetBytes) : budgetBytes_(budgetBytes) {}
+
+const TextTextureCache::Entry *TextTextureCache::find(const TextCacheKey &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    ++stats_.hits;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return &it->second->second;
+}
+
+const TextTextureCache::Entry &TextTextureCache::insert(TextCacheKey key, raii::SDL_Texture texture) {
+    assert(texture);
+
+    auto existing = index_.find(key);
+    if (existing != index_.end()) erase(existing->second);
+
+    int w = 0, h = 0;
+    requireSDLCondition(SDL_QueryTexture(texture.get(), nullptr, nullptr, &w, &h) == 0);
+
+    lru_.emplace_front(std::move(key), Entry{std::move(texture), w, h});
+    index_.emplace(lru_.front().first, lru_.begin());
+    usedBytes_ += entryBytes(lru_.front().second);
+
+    evictToBudget();
+
+    // The entry just inserted is never evicted, even if it alone exceeds the budget.
+    return lru_.front().second;
+}
+
+void TextTextureCache::invalidateFace(uint64_t faceId) {
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        auto next = std::next(it);
+        if (it->first.faceId == faceId) erase(it);
+        it = next;
+    }
+}
+
+void TextTextureCache::clear() {
+    index_.clear();
+    lru_.clear();
+    usedBytes_ = 0;
+}
+
+void TextTextureCache::setBudget(size_t budgetBytes) {
+    budgetBytes_ = budgetBytes;
+    evictToBudget();
+}
+
+size_t TextTextureCache::getBudget() const { return budgetBytes_; }
+size_t TextTextureCache::getUsedBytes() const { return usedBytes_; }
+size_t TextTextureCache::getEntryCount() const { return lru_.size(); }
+const TextTextureCache::Stats &TextTextureCache::getStats() const { return stats_; }
+
+size_t TextTextureCache::entryBytes(const Entry &entry) {
+    return static_cast<size_t>(entry.width) * static_cast<size_t>(entry.height) * 4;
+}
+
+void TextTextureCache::evictToBudget() {
+    while (usedBytes_ > budgetBytes_ && lru_.size() > 1) {
+        erase(std::prev(lru_.end()));
+        ++stats_.evictions;
+    }
+}
+
+void TextTextureCache::erase(LRUList::iterator it) {
+    usedBytes_ -= entryBytes(it->second);
+    index_.erase(it->first);
+    lru_.erase(it);
+}
+
+}
@@ -0,0 +1,111 @@
+#include "TexturePool.hpp"
+
+#include <bit>
+#include <functional>
+
+namespace ia {
+
+// ---------------- TexturePool ----------------
+TexturePool::TexturePool(const raii::SDL_Renderer &renderer, RenderState &renderState)
+    : renderer_(renderer), renderState_(renderState) {}
+
+TexturePool::~TexturePool() { trim(); }
+
+TexturePool::Allocation TexturePool::acquire(Uint32 format, int width, int height) {
+    const Key key = {format, sizeClass(width), sizeClass(height)};
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        EntryList::iterator entry = it->second;
+        index_.erase(it);
+
+        Allocation allocation = std::move(entry->allocation);
+        idleBytes_ -= bytesOf(allocation);
+        idle_.erase(entry);
+
+        ++stats_.hits;
+        return allocation;
+    }
+
+    ++stats_.misses;
+
+    Allocation allocation;
+    allocation.texture = raii::SDL_CreateTexture(renderer_, format, SDL_TEXTUREACCESS_TARGET, key.width, key.height);
+    requireSDLCondition(allocation.texture != nullptr);
+    allocation.format = format;
+    allocation.width = key.width;
+    allocation.height = key.height;
+    return allocation;
+}
+
+void TexturePool::release(Allocation allocation) {
+    if (!allocation.texture) return;
+
+    const Key key = {allocation.format, allocation.width, allocation.height};
+    idleBytes_ += bytesOf(allocation);
+    idle_.push_back(Entry{key, std::move(allocation), frame_});
+    index_.emplace(key, std::prev(idle_.end()));
+
+    ++stats_.releases;
+    enforceBudget();
+}
+
+void TexturePool::endFrame() {
+    ++frame_;
+    trim(maxIdleFrames_);
+}
+
+void TexturePool::trim(size_t maxIdleFrames) {
+    while (!idle_.empty() && frame_ - idle_.front().releasedFrame >= maxIdleFrames) evict(idle_.begin());
+}
+
+void TexturePool::setMaxIdleFrames(size_t frames) { maxIdleFrames_ = frames; }
+
+void TexturePool::setIdleBudget(size_t bytes) {
+    idleBudget_ = bytes;
+    enforceBudget();
+}
+
+size_t TexturePool::getIdleBytes() const { return idleBytes_; }
+size_t TexturePool::getIdleCount() const { return idle_.size(); }
+const TexturePool::Stats &TexturePool::getStats() const { return stats_; }
+
+int TexturePool::sizeClass(int size) {
+    if (size <= MIN_CLASS_SIZE) return MIN_CLASS_SIZE;
+
+    const int base = std::bit_floor(static_cast<unsigned>(size));
+    const int step = base / 4;
+    return (size + step - 1) / step * step;
+}
+
+size_t TexturePool::KeyHash::operator()(const Key &key) const noexcept {
+    size_t hash = std::hash<Uint32>{}(key.format);
+    hash ^= std::hash<int>{}(key.width) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int>{}(key.height) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+void TexturePool::evict(EntryList::iterator entry) {
+    auto [first, last] = index_.equal_range(entry->key);
+    for (auto it = first; it != last; ++it) {
+        if (it->second == entry) {
+            index_.erase(it);
+            break;
+        }
+    }
+
+    idleBytes_ -= bytesOf(entry->allocation);
+    renderState_.forgetTarget(entry->allocation.texture.get());
+    idle_.erase(entry);
+    ++stats_.evictions;
+}
+
+void TexturePool::enforceBudget() {
+    while (!idle_.empty() && idleBytes_ > idleBudget_) evict(idle_.begin());
+}
+
+size_t TexturePool::bytesOf(const Allocation &allocation) {
+    return static_cast<size_t>(allocation.width) * static_cast<size_t>(allocation.height) * 4;
+}
+
+}
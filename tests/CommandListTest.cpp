@@ -0,0 +1,121 @@
+// Checks that ia::CommandList::merge runs commands with the same effect as recording every
+// layer in order, and within a layer the lists in order, on a single thread.
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "CommandList.hpp"
+
+namespace {
+
+constexpr int TARGET_COUNT = 6;
+constexpr int ROUNDS = 2000;
+
+struct Op {
+    int layer;
+    size_t list;
+    size_t sequence;
+    const void *target;
+    const void *source;
+    int id;
+};
+
+// What each target ends up holding: the ids drawn to it, each with a copy of its source.
+using State = std::map<const void *, std::string>;
+
+void apply(State &state, const void *target, const void *source, int id) {
+    std::string drawn = "(" + std::to_string(id);
+    if (source) drawn += ":" + state[source];
+    drawn += ")";
+    state[target] += drawn;
+}
+
+int checkRandom() {
+    std::mt19937 rng(1);
+    int targets[TARGET_COUNT];
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        std::vector<ia::CommandList> lists(1 + rng() % 4);
+        std::vector<Op> ops;
+        State merged;
+        int id = 0;
+
+        for (size_t list = 0; list < lists.size(); ++list) {
+            const size_t count = rng() % 16;
+            for (size_t sequence = 0; sequence < count; ++sequence) {
+                const void *target = &targets[rng() % TARGET_COUNT];
+                const void *source = nullptr;
+                switch (rng() % 4) {
+                    case 0: source = &targets[rng() % TARGET_COUNT]; break;   // may read a written target
+                    case 1: source = target; break;                          // self-draw
+                    default: break;
+                }
+                const int layer = static_cast<int>(rng() % 3);
+
+                ops.push_back(Op{layer, list, sequence, target, source, id});
+                lists[list].setLayer(layer);
+                lists[list].record([&merged, target, source, id] { apply(merged, target, source, id); },
+                                   target, source);
+                ++id;
+            }
+        }
+
+        std::sort(ops.begin(), ops.end(), [](const Op &a, const Op &b) {
+            return std::tie(a.layer, a.list, a.sequence) < std::tie(b.layer, b.list, b.sequence);
+        });
+        State serial;
+        for (const Op &op : ops) apply(serial, op.target, op.source, op.id);
+
+        std::vector<ia::CommandList *> pointers;
+        for (ia::CommandList &list : lists) pointers.push_back(&list);
+        {
+            ia::CommandList::Merged result = ia::CommandList::merge(pointers);
+            if (result.size() != ops.size()) {
+                std::printf("round %d: merged %zu of %zu commands\n", round, result.size(), ops.size());
+                return 1;
+            }
+            if (result.execute()) {
+                std::printf("round %d: a command threw\n", round);
+                return 1;
+            }
+        }
+        for (const ia::CommandList &list : lists) {
+            if (!list.empty()) {
+                std::printf("round %d: merge left commands in a list\n", round);
+                return 1;
+            }
+        }
+        if (merged != serial) {
+            std::printf("round %d: merged state differs from serial recording\n", round);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Also replays fine from buffers handed back by an earlier Merged.
+int checkReuse() {
+    ia::CommandList list;
+    int sum = 0;
+    for (int frame = 0; frame < 8; ++frame) {
+        for (int i = 0; i < 5000; ++i) list.record([&sum] { ++sum; }, &list, nullptr);
+        ia::CommandList *pointer = &list;
+        if (ia::CommandList::merge(std::span(&pointer, 1)).execute()) return 1;
+    }
+    if (sum != 8 * 5000) {
+        std::printf("reused buffers ran %d of %d commands\n", sum, 8 * 5000);
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+int main() {
+    return checkRandom() || checkReuse() ? 1 : 0;
+}
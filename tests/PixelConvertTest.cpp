@@ -0,0 +1,166 @@
+// Checks the kernels of every ISA the CPU supports against expected values, and the SIMD
+// kernels against exactly the scalar results, in the vector body as well as in the tail.
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "PixelConvert.hpp"
+
+namespace {
+
+using Kernel = std::function<void(std::vector<dr4::Color> &pixels)>;
+
+// Every (channel, alpha) pair, so premultiplied and invalid (c > a) inputs are both covered.
+std::vector<dr4::Color> allPairs() {
+    std::vector<dr4::Color> pixels;
+    for (unsigned a = 0; a < 256; ++a) {
+        for (unsigned c = 0; c < 256; ++c) {
+            pixels.push_back(dr4::Color(static_cast<Uint8>(c), static_cast<Uint8>(255 - c),
+                                        static_cast<Uint8>(c / 2), static_cast<Uint8>(a)));
+        }
+    }
+    return pixels;
+}
+
+std::vector<dr4::Color> run(ia::PixelIsa isa, const Kernel &kernel, std::vector<dr4::Color> pixels) {
+    ia::setPixelIsa(isa);
+    kernel(pixels);
+    return pixels;
+}
+
+// Shifting the input by 0..7 pixels moves each pixel between vector body and tail.
+int check(const char *name, ia::PixelIsa isa, const Kernel &kernel) {
+    int failures = 0;
+    const std::vector<dr4::Color> input = allPairs();
+    for (size_t shift = 0; shift < 8; ++shift) {
+        std::vector<dr4::Color> shifted(input.begin() + shift, input.end());
+        shifted.insert(shifted.end(), input.begin(), input.begin() + shift);
+
+        const std::vector<dr4::Color> expected = run(ia::PixelIsa::SCALAR, kernel, shifted);
+        const std::vector<dr4::Color> actual = run(isa, kernel, shifted);
+        for (size_t i = 0; i < shifted.size(); ++i) {
+            if (std::memcmp(&expected[i], &actual[i], sizeof(dr4::Color)) == 0) continue;
+            if (++failures <= 8) {
+                std::printf("%s, isa %d, shift %zu: pixel %zu differs from scalar\n",
+                            name, static_cast<int>(isa), shift, i);
+            }
+        }
+    }
+    return failures;
+}
+
+// Byte orders in memory, independent of the kernels: BGRA32 is B, G, R, A and ARGB32 is
+// A, R, G, B. 37 pixels cover an AVX2 and an SSE2 body plus a tail.
+int checkSwizzles(ia::PixelIsa isa) {
+    struct Expected {
+        Uint32 format;
+        std::array<int, 4> channels;   // index into R, G, B, A for each byte
+    };
+    const Expected expected[] = {
+        {SDL_PIXELFORMAT_RGBA32, {0, 1, 2, 3}},
+        {SDL_PIXELFORMAT_BGRA32, {2, 1, 0, 3}},
+        {SDL_PIXELFORMAT_ARGB32, {3, 0, 1, 2}},
+        {SDL_PIXELFORMAT_ABGR32, {3, 2, 1, 0}},
+    };
+
+    ia::setPixelIsa(isa);
+    int failures = 0;
+    for (const Expected &format : expected) {
+        std::vector<dr4::Color> pixels;
+        for (int i = 0; i < 37; ++i) {
+            pixels.push_back(dr4::Color(static_cast<Uint8>(4 * i), static_cast<Uint8>(4 * i + 1),
+                                        static_cast<Uint8>(4 * i + 2), static_cast<Uint8>(4 * i + 3)));
+        }
+        std::vector<Uint32> packed(pixels.size());
+        ia::packColors(pixels, packed.data(), format.format);
+
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            const Uint8 channels[4] = {pixels[i].r, pixels[i].g, pixels[i].b, pixels[i].a};
+            Uint8 bytes[4];
+            std::memcpy(bytes, &packed[i], 4);
+            for (int byte = 0; byte < 4; ++byte) {
+                if (bytes[byte] == channels[format.channels[byte]]) continue;
+                if (++failures <= 8) {
+                    std::printf("%s, isa %d: pixel %zu byte %d is %d\n", SDL_GetPixelFormatName(format.format),
+                                static_cast<int>(isa), i, byte, bytes[byte]);
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+// premultiply gives round(c * a / 255) and keeps alpha. Unpremultiplying that and
+// premultiplying again gives the same pixel back, and alpha 255 is left alone.
+int checkAlpha(ia::PixelIsa isa) {
+    ia::setPixelIsa(isa);
+    std::vector<dr4::Color> pixels = allPairs();
+    const std::vector<dr4::Color> straight = pixels;
+
+    int failures = 0;
+    auto expect = [&](bool ok, const char *what, size_t i) {
+        if (ok) return;
+        if (++failures <= 8) {
+            std::printf("%s, isa %d: c %d a %d\n", what, static_cast<int>(isa), straight[i].r, straight[i].a);
+        }
+    };
+
+    ia::premultiplyAlpha(pixels);
+    const std::vector<dr4::Color> premultiplied = pixels;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        const dr4::Color &in = straight[i];
+        const dr4::Color &out = premultiplied[i];
+        auto scaled = [&in](Uint8 c) { return static_cast<long>(std::lround(c * in.a / 255.0)); };
+        expect(out.r == scaled(in.r) && out.g == scaled(in.g) && out.b == scaled(in.b) && out.a == in.a,
+               "premultiply", i);
+    }
+
+    ia::unpremultiplyAlpha(pixels);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        if (straight[i].a == 255) {
+            expect(std::memcmp(&pixels[i], &straight[i], sizeof(dr4::Color)) == 0, "unpremultiply at alpha 255", i);
+        }
+    }
+    ia::premultiplyAlpha(pixels);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        expect(std::memcmp(&pixels[i], &premultiplied[i], sizeof(dr4::Color)) == 0, "unpremultiply round trip", i);
+    }
+    return failures;
+}
+
+}
+
+int main() {
+    const Kernel premultiply = [](std::vector<dr4::Color> &pixels) { ia::premultiplyAlpha(pixels); };
+    const Kernel unpremultiply = [](std::vector<dr4::Color> &pixels) { ia::unpremultiplyAlpha(pixels); };
+    const Uint32 formats[] = {SDL_PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_BGRA32, SDL_PIXELFORMAT_ARGB32, SDL_PIXELFORMAT_ABGR32};
+
+    ia::setPixelIsa(ia::PixelIsa::AVX2);
+    const ia::PixelIsa supported = ia::getPixelIsa();
+
+    int failures = 0;
+    for (ia::PixelIsa isa : {ia::PixelIsa::SCALAR, ia::PixelIsa::SSE2, ia::PixelIsa::AVX2}) {
+        if (isa > supported) continue;
+
+        failures += checkSwizzles(isa);
+        failures += checkAlpha(isa);
+        if (isa == ia::PixelIsa::SCALAR) continue;
+
+        failures += check("premultiply", isa, premultiply);
+        failures += check("unpremultiply", isa, unpremultiply);
+        for (Uint32 format : formats) {
+            const Kernel convert = [format](std::vector<dr4::Color> &pixels) {
+                const int width = static_cast<int>(pixels.size());
+                ia::convertPixels(pixels.data(), width * 4, ia::CANONICAL_PIXEL_FORMAT,
+                                  pixels.data(), width * 4, format, width, 1);
+            };
+            failures += check(SDL_GetPixelFormatName(format), isa, convert);
+        }
+    }
+
+    if (failures) std::printf("%d mismatches\n", failures);
+    return failures ? 1 : 0;
+}